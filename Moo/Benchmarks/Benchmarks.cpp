@@ -0,0 +1,127 @@
+#include "LoggerBenchmarks.h"
+#include "ScopedArray.hpp"
+#include "Time.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace moo;
+using namespace std;
+
+namespace {
+    // Runs aFunc aIterations times and returns the average time of one call in nanoseconds
+    template<class Func>
+    double MeasureNs(size_t aIterations, Func&& aFunc)
+    {
+        const auto start = chrono::steady_clock::now();
+
+        for (size_t i = 0; i < aIterations; ++i)
+        {
+            aFunc(i);
+        }
+
+        const chrono::duration<double, nano> elapsed = chrono::steady_clock::now() - start;
+        return elapsed.count() / static_cast<double>(aIterations);
+    }
+
+    void Report(const char* aName, double aNs)
+    {
+        cout << aName << ": " << aNs << " ns/op" << endl;
+    }
+
+    void TimeStampBenchmarks()
+    {
+        constexpr size_t iterations = 1000000;
+        constexpr streamsize fractionSeconds = 4;
+
+        // A new time for each call, 1 microsecond apart, so the cached second changes now and then
+        const auto start = chrono::system_clock::now();
+        const auto timeAt = [&](size_t i) { return start + chrono::microseconds(i); };
+
+        size_t checksum = 0;
+
+        Report("TimeStampString", MeasureNs(iterations, [&](size_t i)
+            {
+                checksum += TimeStampString(timeAt(i), fractionSeconds).size();
+            }));
+
+        Report("TimeStampFormatter", MeasureNs(iterations, [&](size_t i)
+            {
+                checksum += TimeStampFormatter::Format(timeAt(i), fractionSeconds).size();
+            }));
+
+        Report("TimeStampFormatter (date)", MeasureNs(iterations, [&](size_t i)
+            {
+                checksum += TimeStampFormatter::Format(timeAt(i), fractionSeconds, true).size();
+            }));
+
+        cout << "checksum: " << checksum << endl;
+    }
+
+    // What ScopedArray::operator= used to do: copy the range, allocate zeroed elements, then move one at a time
+    template<class T>
+    void AssignElementwise(ScopedArray<T>& aArray, vector<T> aRange)
+    {
+        aArray.Reset(aRange.size());
+
+        auto itData = aArray.begin();
+        for (auto& item : aRange)
+        {
+            *itData = T(std::move(item));
+            ++itData;
+        }
+    }
+
+    template<class T>
+    void ScopedArrayAssignBenchmark(const string& aName, size_t aSize)
+    {
+        // About the same number of elements copied for every size
+        const size_t iterations = max<size_t>(10, (size_t(256) << 20) / aSize / sizeof(T));
+
+        const vector<T> range(aSize, T(1));
+        ScopedArray<T> array(aSize);
+        size_t checksum = 0;
+
+        const double elementwiseNs = MeasureNs(iterations, [&](size_t)
+            {
+                AssignElementwise(array, range);
+                checksum += static_cast<size_t>(array[aSize - 1]);
+            });
+
+        const double assignNs = MeasureNs(iterations, [&](size_t)
+            {
+                array = range;
+                checksum += static_cast<size_t>(array[aSize - 1]);
+            });
+
+        const double newSizeNs = MeasureNs(iterations, [&](size_t i)
+            {
+                // A different size each time, so a new buffer is allocated
+                array = span(range).first(aSize - i % 2);
+                checksum += static_cast<size_t>(array[0]);
+            });
+
+        Report((aName + ", elementwise").c_str(), elementwiseNs);
+        Report((aName + ", same size").c_str(), assignNs);
+        Report((aName + ", new size").c_str(), newSizeNs);
+        cout << "checksum: " << checksum << endl;
+    }
+
+    void ScopedArrayBenchmarks()
+    {
+        ScopedArrayAssignBenchmark<float>("ScopedArray<float> = 1K", 1024);
+        ScopedArrayAssignBenchmark<float>("ScopedArray<float> = 1M", 1024 * 1024);
+        ScopedArrayAssignBenchmark<unsigned char>("ScopedArray<unsigned char> = 16M", 16 * 1024 * 1024);
+    }
+}
+
+// Benchmarks [<logger results path>]
+int main(int argc, char* argv[])
+{
+    TimeStampBenchmarks();
+    ScopedArrayBenchmarks();
+    LoggerBenchmarks(argc > 1 ? argv[1] : "LoggerBenchmarks.jsonl");
+    return 0;
+}
@@ -0,0 +1,279 @@
+#include "LoggerBenchmarks.h"
+
+#include "Logger.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace moo;
+using namespace std;
+
+namespace {
+    constexpr const char* cLogPath = "LoggerBenchmark.log";
+    constexpr size_t cMessagesPerRun = 40000;
+
+    enum class Mode { Sync, ThreadLocal, Async };
+    enum class Stream { Out, Log, Err };
+
+    struct Config {
+        Stream stream = Stream::Log;
+        Mode mode = Mode::Sync;
+        size_t threads = 4;
+        size_t messageSize = 64;
+        size_t linesPerMessage = 1;
+        bool timeStamp = true;
+        streamsize fractionSeconds = 4;
+    };
+
+    struct Result {
+        double linesPerSecond = 0;
+        double p50Ns = 0;
+        double p99Ns = 0;
+        double p999Ns = 0;
+    };
+
+    const char* ToString(Mode aMode)
+    {
+        switch (aMode)
+        {
+        case Mode::Sync:
+            return "sync";
+        case Mode::ThreadLocal:
+            return "threadLocal";
+        case Mode::Async:
+            return "async";
+        }
+
+        return "";
+    }
+
+    const char* ToString(Stream aStream)
+    {
+        switch (aStream)
+        {
+        case Stream::Out:
+            return "cout";
+        case Stream::Log:
+            return "clog";
+        case Stream::Err:
+            return "cerr";
+        }
+
+        return "";
+    }
+
+    ostream& OS(Stream aStream)
+    {
+        switch (aStream)
+        {
+        case Stream::Out:
+            return cout;
+        case Stream::Err:
+            return cerr;
+        default:
+            return clog;
+        }
+    }
+
+    // aSize characters in aLines lines, without the last new line, which is the endl
+    string Message(size_t aSize, size_t aLines)
+    {
+        string message(max(aSize, aLines), 'x');
+        const size_t lineSize = message.size() / aLines;
+
+        for (size_t line = 1; line < aLines; ++line)
+        {
+            message[line * lineSize - 1] = '\n';
+        }
+
+        return message;
+    }
+
+    double Percentile(const vector<double>& aSorted, double aFraction)
+    {
+        const size_t index = min(aSorted.size() - 1, static_cast<size_t>(aFraction * aSorted.size()));
+        return aSorted[index];
+    }
+
+    Result Run(const Config& aConfig)
+    {
+        Logger::TimeStamp(aConfig.timeStamp);
+        Logger::TimeStampFractionSeconds(aConfig.fractionSeconds);
+        Logger::ThreadLocalBuffers(aConfig.mode == Mode::ThreadLocal);
+        Logger::Async(aConfig.mode == Mode::Async);
+
+        const string message = Message(aConfig.messageSize, aConfig.linesPerMessage);
+        const size_t messagesPerThread = cMessagesPerRun / aConfig.threads;
+        const bool lock = aConfig.mode != Mode::ThreadLocal;
+
+        vector<vector<double>> latencies(aConfig.threads, vector<double>(messagesPerThread));
+        atomic<size_t> ready = 0;
+        chrono::steady_clock::time_point start;
+        chrono::steady_clock::time_point stop;
+
+        {
+            Logger logger(cLogPath);
+            vector<thread> threads;
+
+            for (size_t t = 0; t < aConfig.threads; ++t)
+            {
+                threads.emplace_back([&, t]()
+                    {
+                        ostream& os = OS(aConfig.stream);
+                        vector<double>& threadLatencies = latencies[t];
+
+                        // Start together
+                        ++ready;
+                        while (ready.load() < aConfig.threads)
+                        {
+                            this_thread::yield();
+                        }
+
+                        for (size_t i = 0; i < messagesPerThread; ++i)
+                        {
+                            const auto callStart = chrono::steady_clock::now();
+
+                            if (lock)
+                            {
+                                Logger::Lock logLock;
+                                os << message << endl;
+                            }
+                            else
+                            {
+                                os << message << endl;
+                            }
+
+                            const chrono::duration<double, nano> elapsed = chrono::steady_clock::now() - callStart;
+                            threadLatencies[i] = elapsed.count();
+                        }
+                    });
+            }
+
+            while (ready.load() < aConfig.threads)
+            {
+                this_thread::yield();
+            }
+
+            start = chrono::steady_clock::now();
+
+            for (thread& thread : threads)
+            {
+                thread.join();
+            }
+        }
+
+        // After the Logger is gone, so in Async mode everything queued is written too
+        stop = chrono::steady_clock::now();
+
+        vector<double> all;
+        all.reserve(aConfig.threads * messagesPerThread);
+
+        for (const vector<double>& threadLatencies : latencies)
+        {
+            all.insert(all.end(), threadLatencies.begin(), threadLatencies.end());
+        }
+
+        sort(all.begin(), all.end());
+
+        const chrono::duration<double> seconds = stop - start;
+        const double lines = static_cast<double>(all.size() * aConfig.linesPerMessage);
+
+        error_code error;
+        filesystem::remove(cLogPath, error);
+
+        return { lines / seconds.count(), Percentile(all, 0.5), Percentile(all, 0.99), Percentile(all, 0.999) };
+    }
+
+    void WriteJson(ostream& aOut, const Config& aConfig, const Result& aResult)
+    {
+        aOut << fixed << setprecision(1)
+             << "{\"stream\":\"" << ToString(aConfig.stream) << "\""
+             << ",\"mode\":\"" << ToString(aConfig.mode) << "\""
+             << ",\"threads\":" << aConfig.threads
+             << ",\"messageSize\":" << aConfig.messageSize
+             << ",\"linesPerMessage\":" << aConfig.linesPerMessage
+             << ",\"timeStamp\":" << (aConfig.timeStamp ? "true" : "false")
+             << ",\"fractionSeconds\":" << aConfig.fractionSeconds
+             << ",\"linesPerSecond\":" << aResult.linesPerSecond
+             << ",\"p50Ns\":" << aResult.p50Ns
+             << ",\"p99Ns\":" << aResult.p99Ns
+             << ",\"p999Ns\":" << aResult.p999Ns
+             << "}\n";
+    }
+
+    // The baseline, and then one setting changed at a time
+    vector<Config> Configs()
+    {
+        const Config baseline;
+        vector<Config> configs = { baseline };
+
+        const auto vary = [&](auto aSet)
+        {
+            Config config = baseline;
+            aSet(config);
+            configs.push_back(config);
+        };
+
+        for (size_t threads : { 1, 2, 8 })
+        {
+            vary([&](Config& aConfig) { aConfig.threads = threads; });
+        }
+
+        for (size_t messageSize : { 16, 256, 1024 })
+        {
+            vary([&](Config& aConfig) { aConfig.messageSize = messageSize; });
+        }
+
+        for (size_t linesPerMessage : { 4, 16 })
+        {
+            vary([&](Config& aConfig) { aConfig.linesPerMessage = linesPerMessage; });
+        }
+
+        vary([](Config& aConfig) { aConfig.timeStamp = false; });
+
+        for (streamsize fractionSeconds : { 0, 3, 6 })
+        {
+            vary([&](Config& aConfig) { aConfig.fractionSeconds = fractionSeconds; });
+        }
+
+        for (Stream stream : { Stream::Out, Stream::Err })
+        {
+            vary([&](Config& aConfig) { aConfig.stream = stream; });
+        }
+
+        for (Mode mode : { Mode::ThreadLocal, Mode::Async })
+        {
+            vary([&](Config& aConfig) { aConfig.mode = mode; });
+        }
+
+        return configs;
+    }
+}
+
+void moo::LoggerBenchmarks(const string& aResultsPath)
+{
+    ofstream results(aResultsPath);
+
+    for (const Config& config : Configs())
+    {
+        // cout is redirected while the Logger runs, so the summary is written after each run
+        const Result result = Run(config);
+
+        WriteJson(results, config, result);
+        WriteJson(cout, config, result);
+    }
+
+    Logger::TimeStamp(true);
+    Logger::TimeStampFractionSeconds(4);
+    Logger::ThreadLocalBuffers(false);
+    Logger::Async(false);
+
+    cout << "Logger results: " << aResultsPath << endl;
+}
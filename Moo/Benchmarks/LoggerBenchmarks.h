@@ -0,0 +1,10 @@
+#pragma once
+
+#include <string>
+
+namespace moo {
+    // Lines per second and per call latency percentiles of writing to the redirected std streams, over thread
+    // counts, message sizes, lines per message, time stamp settings, streams and Logger modes.
+    // Each run is written to aResultsPath as one JSON object per line, and summarized on cout.
+    void LoggerBenchmarks(const std::string& aResultsPath);
+}
@@ -0,0 +1,83 @@
+#include "BinaryLog.h"
+
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+
+using namespace moo;
+using namespace std;
+
+namespace {
+    void Usage()
+    {
+        cerr << "Usage: BinaryLogDecoder <binary log> [<text log>] [--fraction-seconds <width>]" << endl
+             << "Writes the binary log as text, to standard output when no text log is given." << endl;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    string inPath;
+    string outPath;
+    streamsize fractionSeconds = 4; // Logger::TimeStampFractionSeconds default
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const string arg = argv[i];
+
+        if (arg == "--fraction-seconds" && i + 1 < argc)
+        {
+            fractionSeconds = stoi(argv[++i]);
+        }
+        else if (inPath.empty())
+        {
+            inPath = arg;
+        }
+        else if (outPath.empty())
+        {
+            outPath = arg;
+        }
+        else
+        {
+            Usage();
+            return 1;
+        }
+    }
+
+    if (inPath.empty())
+    {
+        Usage();
+        return 1;
+    }
+
+    ifstream in(inPath, ios::binary);
+
+    if (!in)
+    {
+        cerr << "Can't open " << inPath << endl;
+        return 1;
+    }
+
+    const string binaryLog{istreambuf_iterator<char>(in), istreambuf_iterator<char>()};
+
+    try
+    {
+        if (outPath.empty())
+        {
+            DecodeBinaryLog(binaryLog, cout, fractionSeconds);
+        }
+        else
+        {
+            ofstream out(outPath);
+            DecodeBinaryLog(binaryLog, out, fractionSeconds);
+        }
+    }
+    catch (const exception& e)
+    {
+        cerr << inPath << ": " << e.what() << endl;
+        return 1;
+    }
+
+    return 0;
+}
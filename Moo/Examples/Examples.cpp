@@ -1,9 +1,19 @@
+#include "BinaryLog.h"
+#include "FlightRecorder.h"
+#include "Log.hpp"
 #include "Logger.h"
+#include "LogSink.h"
+#include "MappedArray.h"
 
+#include <algorithm>
 #include <iostream>
 #include <thread>
 #include <array>
 
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
 using namespace moo;
 using namespace std;
 
@@ -66,6 +76,203 @@ int main()
         }
     }
 
+    {
+        Logger::Async(true);
+        Logger logger("LogExample3.log");
+
+        Logger::Lock lock;
+        clog << "Written by the writer thread" << endl;
+        cerr << "So is this ERROR" << endl;
+    }
+
+    {
+        Logger::ThreadLocalBuffers(true);
+        Logger logger("LogExample4.log");
+
+        constexpr size_t threadCount = 8;
+        array<thread, threadCount> threads;
+        for (size_t i = 0; i < threadCount; ++i)
+        {
+            threads[i] = thread([i]()
+                {
+                    // No Logger::Lock needed, each line is handed over whole at endl
+                    for (size_t j = 0; j < 10; ++j)
+                    {
+                        clog << "Thread " << i << " loop: " << j << endl;
+                    }
+                });
+        }
+
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+    }
+
+    {
+        Logger::MappedLogFile(true);
+        Logger logger("LogExample5.log");
+
+        clog << "Copied straight into a memory mapping" << endl;
+    }
+
+    {
+        Logger::MappedLogFile(false);
+        Logger::Rotation({ .maxBytes = 1024, .keepFiles = 3 });
+        Logger logger("LogExample6.log");
+
+        // Rolls over to LogExample6.<n>.log every KB, keeping the newest 3
+        for (size_t i = 0; i < 100; ++i)
+        {
+            clog << "Rotating line " << i << endl;
+        }
+    }
+
+    {
+        BinaryLogger binaryLogger("LogExample7.blog");
+
+        // Only the arguments are written, BinaryLogDecoder turns LogExample7.blog into text
+        for (size_t i = 0; i < 10; ++i)
+        {
+            MOO_BLOG(Info, "Binary line {} of {}, {}", i, 10, i % 2 == 0 ? "even" : "odd");
+        }
+    }
+
+    {
+        Logger::Rotation({});
+        Logger logger("LogExample8.log");
+
+        // Each statement is registered once, and its records only carry the id of the site
+        MOO_LOG(Info, "Site logging, {} + {} = {}", 1, 2, 1 + 2);
+        MOO_LOG(Error, "Errors go to the same place as cerr");
+
+        // The number of arguments is checked when it's compiled, and they're formatted without iostreams
+        MOO_LOGF(Info, "Formatted directly, {} of {} at {}", 3, 4, 0.75);
+
+        // Below MOO_LOG_MIN_LEVEL a statement compiles to nothing; above it, a disabled site
+        // doesn't evaluate its arguments
+        LogSite::MinLevel(LogLevel::Info);
+        MOO_TRACE("Not logged, and {} is never called", "expensive()");
+        MOO_WARN("Logged, {} sites so far", LogSite::LastId());
+        LogSite::MinLevel(LogLevel::Trace);
+
+        // Messages over the rate of a site are only counted, and repeats of the same one are collapsed
+        LogSite::DefaultLimits({ .perSecond = 1, .burst = 2 });
+
+        for (size_t i = 0; i < 100; ++i)
+        {
+            MOO_WARN("Noisy, {}", i);
+        }
+
+        LogSite::DefaultLimits({ .collapseDuplicates = true });
+
+        for (size_t i = 0; i < 100; ++i)
+        {
+            MOO_INFO("Same every time");
+        }
+
+        LogSite::DefaultLimits({});
+    }
+
+    {
+        Logger::LockStats(true);
+
+        {
+            Logger logger("LogExample10.log");
+            array<thread, 4> threads;
+
+            for (size_t i = 0; i < threads.size(); ++i)
+            {
+                threads[i] = thread([i]()
+                    {
+                        for (size_t j = 0; j < 1000; ++j)
+                        {
+                            Logger::Lock lock;
+                            clog << "Thread " << i << " line " << j << endl;
+                        }
+                    });
+            }
+
+            for (auto& thread : threads)
+            {
+                thread.join();
+            }
+        }
+
+        // Counted for every thread that took the Lock while the stats were on
+        const LoggerThreadStats total = Logger::Stats().Total();
+        cout << "Lock acquisitions: " << total.acquisitions
+             << ", wait p99 < " << total.lockWait.PercentileNs(0.99) << " ns"
+             << ", hold p99 < " << total.lockHold.PercentileNs(0.99) << " ns" << endl;
+
+        Logger::LockStats(false);
+    }
+
+    {
+        // cout chatter never makes a thread wait, cerr always does
+        Logger::Async(true);
+        Logger::AsyncQueueSize(64);
+        Logger::OverflowPolicy(cout, Logger::Overflow::DropNewest);
+        Logger::OverflowPolicy(cerr, Logger::Overflow::Block);
+
+        uint64_t dropped = 0;
+
+        {
+            Logger logger("LogExample11.log");
+
+            for (size_t i = 0; i < 10000; ++i)
+            {
+                Logger::Lock lock;
+                cout << "Chatter " << i << endl;
+            }
+
+            dropped = Logger::Dropped(cout);
+        }
+
+        cout << "cout records dropped: " << dropped << endl;
+
+        Logger::Async(false);
+        Logger::AsyncQueueSize(8192);
+        Logger::OverflowPolicy(cout, Logger::Overflow::Block);
+    }
+
+    {
+        // Trace messages are only kept in memory, until something goes wrong
+        FlightRecorder::ThreadBytes(16 * 1024);
+        LogSite::MinLevel(LogLevel::Info);
+        Logger logger("LogExample12.log");
+
+        for (size_t i = 0; i < 1000; ++i)
+        {
+            MOO_TRACEF("Step {}", i);
+        }
+
+        // Like an exception caught by NoExcept or a line written to cerr, an error brings the last steps out
+        MOO_ERROR("Step {} failed", 1000);
+
+        LogSite::MinLevel(LogLevel::Trace);
+        FlightRecorder::ThreadBytes(0);
+    }
+
+    {
+        // The file isn't read into memory, its pages come from the OS file cache as they are touched
+        MappedArray<char> log("LogExample2.log", MapMode::ReadOnly, MapAccess::Sequential);
+
+        clog << "LogExample2.log has " << ranges::count(log, '\n') << " lines" << endl;
+    }
+
+#ifndef _WIN32
+    {
+        // Standard output gets what goes to the log file too
+        Logger::Sinks({ make_shared<FdSink>(STDOUT_FILENO) });
+        Logger logger("LogExample9.log");
+
+        clog << "In the file, on standard error and on standard output" << endl;
+    }
+
+    Logger::Sinks({});
+#endif
+
     system("pause");
     return 0;
 }
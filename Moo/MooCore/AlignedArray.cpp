@@ -0,0 +1,51 @@
+#include "AlignedArray.h"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+using namespace std;
+using namespace moo;
+
+namespace {
+    struct Layout {
+        size_t bytes;
+        size_t alignment;
+    };
+
+    Layout LayoutOf(size_t aBytes, size_t aAlignment, size_t aHugePageThreshold) noexcept
+    {
+        const size_t alignment = aHugePageThreshold != 0 && aBytes >= aHugePageThreshold
+            ? max(aAlignment, cHugePageSize)
+            : aAlignment;
+
+        return { (max<size_t>(aBytes, 1) + alignment - 1) / alignment * alignment, alignment };
+    }
+}
+
+void* moo::AllocateAligned(size_t aBytes, size_t aAlignment, size_t aHugePageThreshold)
+{
+    const Layout layout = LayoutOf(aBytes, aAlignment, aHugePageThreshold);
+    void* pData = ::operator new(layout.bytes, align_val_t(layout.alignment));
+
+#ifdef __linux__
+    if (layout.alignment >= cHugePageSize)
+    {
+        // Only a hint, without transparent huge pages it's 4K pages like before
+        madvise(pData, layout.bytes, MADV_HUGEPAGE);
+    }
+#endif
+
+    memset(static_cast<char*>(pData) + aBytes, 0, layout.bytes - aBytes);
+    return pData;
+}
+
+void moo::FreeAligned(void* apData, size_t aBytes, size_t aAlignment, size_t aHugePageThreshold) noexcept
+{
+    const Layout layout = LayoutOf(aBytes, aAlignment, aHugePageThreshold);
+    ::operator delete(apData, layout.bytes, align_val_t(layout.alignment));
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include "ScopedArray.hpp"
+
+#include <bit>
+#include <cstddef>
+
+namespace moo {
+    // The large pages transparent huge pages come in
+    constexpr size_t cHugePageSize = 2 * 1024 * 1024;
+
+    // aBytes rounded up to a multiple of aAlignment, with the padding zeroed. From aHugePageThreshold bytes on
+    // (0 is never) it's aligned to cHugePageSize instead and the OS is asked to back it with huge pages,
+    // which only Linux does.
+    [[nodiscard]] void* AllocateAligned(size_t aBytes, size_t aAlignment, size_t aHugePageThreshold);
+    // Takes the same arguments AllocateAligned got
+    void FreeAligned(void* apData, size_t aBytes, size_t aAlignment, size_t aHugePageThreshold) noexcept;
+
+    // An allocator for vectorized kernels: the elements start at a multiple of cAlignment bytes, and the memory
+    // goes on to the next multiple, so loads of cAlignment bytes never need a mask at the end, see PaddedSize.
+    // Arrays of cHugePageThreshold bytes or more (0 is never) go on transparent huge pages, for fewer TLB misses.
+    template<class T, size_t cAlignment = 64, size_t cHugePageThreshold = 0>
+    struct AlignedAllocator {
+        static_assert(std::has_single_bit(cAlignment) && cAlignment >= alignof(T) && cAlignment % sizeof(T) == 0,
+            "the alignment has to be a power of two holding whole elements");
+
+        using value_type = T;
+
+        template<class U>
+        struct rebind {
+            using other = AlignedAllocator<U, cAlignment, cHugePageThreshold>;
+        };
+
+        AlignedAllocator() noexcept = default;
+        template<class U>
+        AlignedAllocator(const AlignedAllocator<U, cAlignment, cHugePageThreshold>&) noexcept {}
+
+        [[nodiscard]] T* allocate(size_t aCount)
+        {
+            return static_cast<T*>(AllocateAligned(aCount * sizeof(T), cAlignment, cHugePageThreshold));
+        }
+
+        void deallocate(T* apData, size_t aCount) noexcept
+        {
+            FreeAligned(apData, aCount * sizeof(T), cAlignment, cHugePageThreshold);
+        }
+
+        // The elements that can be read starting at data(), padding included
+        [[nodiscard]] static constexpr size_t PaddedSize(size_t aCount) noexcept
+        {
+            constexpr size_t elementsPerAlignment = cAlignment / sizeof(T);
+            return (aCount + elementsPerAlignment - 1) / elementsPerAlignment * elementsPerAlignment;
+        }
+
+        bool operator==(const AlignedAllocator&) const noexcept = default;
+    };
+
+    // A ScopedArray for vectorized kernels, see AlignedAllocator. data(), iteration and CBytes cover
+    // the elements only, never the padding.
+    template<class T, size_t cAlignment = 64, size_t cHugePageThreshold = 0>
+    using AlignedArray = ScopedArray<T, AlignedAllocator<T, cAlignment, cHugePageThreshold>>;
+}
@@ -0,0 +1,85 @@
+#include "ArenaStreamBuf.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+using namespace std;
+using namespace moo;
+
+ArenaStreamBuf::ArenaStreamBuf(size_t aCapacity)
+    : _buffer(max<size_t>(aCapacity, 1), cForOverwrite)
+{
+    Clear();
+}
+
+string_view ArenaStreamBuf::View() const noexcept
+{
+    return { pbase(), static_cast<size_t>(pptr() - pbase()) };
+}
+
+bool ArenaStreamBuf::Empty() const noexcept
+{
+    return pptr() == pbase();
+}
+
+void ArenaStreamBuf::Clear() noexcept
+{
+    _spill.reset();
+    setp(_buffer.data(), _buffer.data() + _buffer.size());
+}
+
+streamsize ArenaStreamBuf::xsputn(const char* apStr, streamsize aCount)
+{
+    const size_t count = static_cast<size_t>(aCount);
+
+    if (static_cast<size_t>(epptr() - pptr()) < count)
+    {
+        Spill(View().size() + count);
+    }
+
+    memcpy(pptr(), apStr, count);
+    Advance(count);
+    return aCount;
+}
+
+ArenaStreamBuf::int_type ArenaStreamBuf::overflow(int_type aChar)
+{
+    if (traits_type::eq_int_type(aChar, traits_type::eof()))
+    {
+        return traits_type::not_eof(aChar);
+    }
+
+    Spill(View().size() + 1);
+
+    *pptr() = traits_type::to_char_type(aChar);
+    pbump(1);
+    return aChar;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// private:
+
+void ArenaStreamBuf::Spill(size_t aMinCapacity)
+{
+    const size_t size = View().size();
+    const size_t capacity = static_cast<size_t>(epptr() - pbase());
+
+    // With room to spare, the rest of an oversize record usually follows
+    ScopedArray<char> spill(max(aMinCapacity + aMinCapacity / 2, capacity * 2), cForOverwrite);
+    memcpy(spill.data(), pbase(), size);
+
+    _spill = move(spill);
+    setp(_spill.data(), _spill.data() + _spill.size());
+    Advance(size);
+}
+
+void ArenaStreamBuf::Advance(size_t aCount) noexcept
+{
+    for (; aCount > INT_MAX; aCount -= INT_MAX)
+    {
+        pbump(INT_MAX);
+    }
+
+    pbump(static_cast<int>(aCount));
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include "MooDefaults.h"
+#include "ScopedArray.hpp"
+
+#include <streambuf>
+#include <string_view>
+
+namespace moo {
+    // A streambuf writing into a buffer allocated once, from which a RedirectStream hands out one record at a time.
+    // A record larger than the buffer spills into a bigger one that Clear releases, so records that fit
+    // cost no allocation after construction.
+    class ArenaStreamBuf : public std::streambuf {
+    public:
+        static constexpr size_t cDefaultCapacity = 4 * 1024;
+
+        explicit ArenaStreamBuf(size_t aCapacity = cDefaultCapacity);
+        MOO_DELETE_DEFAULTS(ArenaStreamBuf);
+
+        // What was written since the last Clear, valid until the next write
+        [[nodiscard]] std::string_view View() const noexcept;
+        [[nodiscard]] bool Empty() const noexcept;
+        // Starts over at the beginning of the preallocated buffer
+        void Clear() noexcept;
+
+    protected:
+        std::streamsize xsputn(const char* apStr, std::streamsize aCount) override;
+        int_type overflow(int_type aChar) override;
+
+    private:
+        void Spill(size_t aMinCapacity);
+        // pbump, which only takes an int, for any size
+        void Advance(size_t aCount) noexcept;
+
+        ScopedArray<char> _buffer;
+        ScopedArray<char> _spill; // only while a record doesn't fit in _buffer
+    };
+}
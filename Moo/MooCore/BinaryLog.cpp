@@ -0,0 +1,298 @@
+#include "BinaryLog.h"
+
+#include "LogFormat.hpp"
+#include "MappedFile.h"
+#include "MooAssert.h"
+#include "Time.hpp"
+
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+using namespace moo;
+
+namespace {
+    // Every BinaryLogger file gets its own id, so the sites describe themselves again in the next file
+    atomic<uint32_t> s_nextFileId = 1;
+
+    // Reads the values of a binary log one after the other
+    class Reader {
+    public:
+        explicit Reader(string_view aData) noexcept : _data(aData) {}
+
+        [[nodiscard]] bool AtEnd() const noexcept
+        {
+            return _pos >= _data.size() || _data[_pos] == '\0';
+        }
+
+        [[nodiscard]] size_t Position() const noexcept
+        {
+            return _pos;
+        }
+
+        template<class T>
+        T Read()
+        {
+            T value;
+            memcpy(&value, Take(sizeof(T)).data(), sizeof(T));
+            return value;
+        }
+
+        string_view ReadString()
+        {
+            return Take(Read<uint32_t>());
+        }
+
+        string_view Take(size_t aSize)
+        {
+            if (aSize > _data.size() - _pos)
+            {
+                throw runtime_error("The binary log is truncated");
+            }
+
+            const string_view taken = _data.substr(_pos, aSize);
+            _pos += aSize;
+            return taken;
+        }
+
+    private:
+        string_view _data;
+        size_t _pos = 0;
+    };
+
+    void WriteArg(Reader aArg, ostream& aOut)
+    {
+        switch (static_cast<BinaryLogger::ArgType>(aArg.Read<uint8_t>()))
+        {
+        case BinaryLogger::ArgType::Bool:
+            aOut << (aArg.Read<uint8_t>() != 0);
+            break;
+        case BinaryLogger::ArgType::Char:
+            aOut << aArg.Read<char>();
+            break;
+        case BinaryLogger::ArgType::Int64:
+            aOut << aArg.Read<int64_t>();
+            break;
+        case BinaryLogger::ArgType::UInt64:
+            aOut << aArg.Read<uint64_t>();
+            break;
+        case BinaryLogger::ArgType::Double:
+            aOut << aArg.Read<double>();
+            break;
+        case BinaryLogger::ArgType::String:
+            aOut << aArg.ReadString();
+            break;
+        }
+    }
+
+    // Splits the arguments of a record, each view holds the type and the value
+    void SplitArgs(string_view aArgs, vector<string_view>& aSplit)
+    {
+        aSplit.clear();
+        Reader reader(aArgs);
+
+        while (!reader.AtEnd())
+        {
+            const size_t start = reader.Position();
+
+            switch (static_cast<BinaryLogger::ArgType>(reader.Read<uint8_t>()))
+            {
+            case BinaryLogger::ArgType::Bool:
+            case BinaryLogger::ArgType::Char:
+                reader.Take(1);
+                break;
+            case BinaryLogger::ArgType::Int64:
+            case BinaryLogger::ArgType::UInt64:
+            case BinaryLogger::ArgType::Double:
+                reader.Take(8);
+                break;
+            case BinaryLogger::ArgType::String:
+                reader.ReadString();
+                break;
+            default:
+                throw runtime_error("Unknown argument type in the binary log");
+            }
+
+            aSplit.push_back(aArgs.substr(start, reader.Position() - start));
+        }
+    }
+
+    struct SiteText {
+        LogLevel level = LogLevel::Info;
+        string_view format;
+    };
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+struct BinaryLogger::Instance {
+    Instance(const string& aPath)
+        : _file(aPath)
+    {
+        string header(cMagic);
+        header += static_cast<char>(cVersion);
+        _file.Write(header);
+    }
+
+    MappedFile _file;
+    const uint32_t _fileId = s_nextFileId++;
+};
+
+BinaryLogger::BinaryLogger(const string& aPath)
+    : _pInstance(make_unique<Instance>(aPath))
+{
+    const bool single = s_running.Start(_pInstance.get());
+    MOO_ASSERT(single && "Only one BinaryLogger can run at a time");
+}
+
+BinaryLogger::~BinaryLogger()
+{
+    // Running() only saves MOO_BLOG the formatting, a call may still be writing to the instance
+    s_running.Stop(_pInstance.get());
+}
+
+//static
+bool BinaryLogger::Running() noexcept
+{
+    return s_running.Running();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// private:
+
+//static
+void BinaryLogger::Write(const LogSite& aSite, string& aRecord)
+{
+    const RunningInstance<Instance>::Use pInstance(s_running);
+
+    if (!pInstance)
+    {
+        return;
+    }
+
+    const uint32_t argumentsSize = static_cast<uint32_t>(aRecord.size() - cRecordHeaderSize);
+    memcpy(aRecord.data() + cRecordHeaderSize - sizeof(uint32_t), &argumentsSize, sizeof(uint32_t));
+
+    uint32_t describedIn = aSite.binaryLogFile.load(memory_order_relaxed);
+
+    if (describedIn != pInstance->_fileId
+        && aSite.binaryLogFile.compare_exchange_strong(describedIn, pInstance->_fileId, memory_order_relaxed))
+    {
+        // Once per site, and the decoder reads all of them before the records, so it can come after this record
+        string site;
+        const auto appendString = [&](const char* apStr)
+        {
+            const string_view str = apStr ? apStr : "";
+            AppendRaw(site, static_cast<uint32_t>(str.size()));
+            site += str;
+        };
+
+        site += cSiteTag;
+        AppendRaw(site, aSite.id);
+        AppendRaw(site, static_cast<uint8_t>(aSite.level));
+        AppendRaw(site, static_cast<uint32_t>(aSite.where.line));
+        appendString(aSite.where.filename);
+        appendString(aSite.where.function);
+        appendString(aSite.format);
+
+        pInstance->_file.Write(site);
+    }
+
+    pInstance->_file.Write(aRecord);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void moo::DecodeBinaryLog(string_view aBinaryLog, ostream& aOut, streamsize aFractionSecondsWidth)
+{
+    Reader reader(aBinaryLog);
+
+    if (reader.Take(BinaryLogger::cMagic.size()) != BinaryLogger::cMagic)
+    {
+        throw runtime_error("Not a binary log");
+    }
+
+    if (reader.Read<uint8_t>() != BinaryLogger::cVersion)
+    {
+        throw runtime_error("Unsupported binary log version");
+    }
+
+    const size_t recordsStart = reader.Position();
+    unordered_map<uint32_t, SiteText> sites;
+
+    // The sites first, a record can come before the description of its site
+    while (!reader.AtEnd())
+    {
+        const char tag = reader.Read<char>();
+
+        if (tag == BinaryLogger::cSiteTag)
+        {
+            SiteText& site = sites[reader.Read<uint32_t>()];
+            site.level = static_cast<LogLevel>(reader.Read<uint8_t>());
+            reader.Read<uint32_t>(); // line
+            reader.ReadString();     // filename
+            reader.ReadString();     // function
+            site.format = reader.ReadString();
+        }
+        else if (tag == BinaryLogger::cRecordTag)
+        {
+            reader.Take(sizeof(uint32_t) + sizeof(int64_t));
+            reader.ReadString();
+        }
+        else
+        {
+            throw runtime_error("Corrupt binary log");
+        }
+    }
+
+    reader = Reader(aBinaryLog);
+    reader.Take(recordsStart);
+
+    ostringstream message;
+    vector<string_view> args;
+
+    while (!reader.AtEnd())
+    {
+        if (reader.Read<char>() == BinaryLogger::cSiteTag)
+        {
+            reader.Take(sizeof(uint32_t) + sizeof(uint8_t) + sizeof(uint32_t));
+            reader.ReadString();
+            reader.ReadString();
+            reader.ReadString();
+            continue;
+        }
+
+        const uint32_t id = reader.Read<uint32_t>();
+        const chrono::system_clock::time_point time{
+            chrono::duration_cast<chrono::system_clock::duration>(chrono::nanoseconds(reader.Read<int64_t>()))};
+        SplitArgs(reader.ReadString(), args);
+
+        message.str({});
+        const auto found = sites.find(id);
+        const SiteText site = found != sites.end() ? found->second : SiteText{};
+
+        if (found == sites.end())
+        {
+            message << "<unknown log site " << id << ">";
+        }
+
+        WriteLogFormat(message, site.format, args.size(),
+            [&](ostream& aArgOut, size_t aIndex) { WriteArg(Reader(args[aIndex]), aArgOut); });
+
+        // Every line of the message gets the prefix, like the Logger does
+        const string text = message.str();
+        const string_view timeStamp = TimeStampFormatter::Format(time, aFractionSecondsWidth);
+        const string_view prefix = site.level == LogLevel::Error ? "-ERR-| " : " log | ";
+        size_t lineStart = 0;
+
+        do
+        {
+            const size_t lineEnd = min(text.find('\n', lineStart), text.size());
+            aOut << timeStamp << prefix << string_view(text).substr(lineStart, lineEnd - lineStart) << '\n';
+            lineStart = lineEnd + 1;
+        } while (lineStart < text.size());
+    }
+}
@@ -0,0 +1,176 @@
+#pragma once
+#include "LogSite.h"
+#include "MooDefaults.h"
+#include "NoExcept.hpp"
+#include "RunningInstance.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <concepts>
+#include <cstdint>
+#include <cstring>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+// Logs "{}" formatted text to the running BinaryLogger, e.g. MOO_BLOG(Info, "frame {} took {} ms", frame, ms);
+// A_LEVEL is a LogLevel name. The arguments are only evaluated while a BinaryLogger is running and the site
+// is enabled, see LogSite.
+#define MOO_BLOG(A_LEVEL, A_FORMAT, ...) \
+    do \
+    { \
+        if (moo::BinaryLogger::Running()) \
+        { \
+            MOO_IF_LOG_SITE_ENABLED(A_LEVEL, A_FORMAT, moo::BinaryLogger::Site{s_mooLogSite}(__VA_ARGS__)); \
+        } \
+    } while (false)
+
+namespace moo {
+    // Log with deferred formatting.
+    // A record is just the id of its LogSite, a time stamp and the raw bytes of the arguments; the rest of the site
+    // is written once, the first time the site logs to the file.
+    // Turning it into text is left for later: DecodeBinaryLog (and the BinaryLogDecoder tool built on it) writes
+    // the same lines the Logger writes for MOO_LOG.
+    //
+    // Records are written through a MappedFile, so threads don't wait for each other.
+    // Only one BinaryLogger can run at a time. The destructor waits for the MOO_BLOG calls still writing to it,
+    // and the ones that come later write nothing.
+    //
+    // File layout, in native byte order:
+    //     "MOOBLOG" cVersion
+    //     'S' id:u32 level:u8 line:u32 filename function format                 - a LogSite
+    //     'R' id:u32 nanoseconds since epoch:i64 argumentsSize:u32 arguments   - a record
+    //     strings are size:u32 and the characters, an argument is an ArgType byte and the value
+    class BinaryLogger {
+    public:
+        static constexpr std::string_view cMagic = "MOOBLOG";
+        static constexpr uint8_t cVersion = 2;
+        static constexpr char cSiteTag = 'S';
+        static constexpr char cRecordTag = 'R';
+
+        enum class ArgType : uint8_t { Bool = 1, Char, Int64, UInt64, Double, String };
+
+        // A record up to its arguments
+        static constexpr size_t cRecordHeaderSize = 1 + sizeof(uint32_t) + sizeof(int64_t) + sizeof(uint32_t);
+
+        explicit BinaryLogger(const std::string& aPath);
+        ~BinaryLogger();
+        MOO_DELETE_DEFAULTS(BinaryLogger);
+
+        [[nodiscard]] static bool Running() noexcept;
+
+        // What MOO_BLOG calls with the arguments
+        class Site {
+        public:
+            explicit Site(const LogSite& aSite) noexcept : _site(aSite) {}
+
+            template<class... Args>
+            void operator()(const Args&... aArgs) const noexcept;
+
+        private:
+            const LogSite& _site;
+        };
+
+    private:
+        struct Instance;
+
+        template<class T>
+        static void AppendRaw(std::string& aBuffer, const T& aValue);
+
+        template<class T>
+        static void AppendArg(std::string& aBuffer, const T& aValue);
+
+        static void Write(const LogSite& aSite, std::string& aRecord);
+
+        std::unique_ptr<Instance> _pInstance;
+
+        static inline RunningInstance<Instance> s_running;
+    };
+
+    // Writes a binary log as text, each line as "<time stamp> log | <message>", or "-ERR-| " for errors.
+    // Throws a std::runtime_error when aBinaryLog isn't one. A zero filled tail (what a MappedFile leaves behind
+    // when the process dies) ends it.
+    void DecodeBinaryLog(std::string_view aBinaryLog, std::ostream& aOut, std::streamsize aFractionSecondsWidth = 4);
+}
+
+template<class... Args>
+void moo::BinaryLogger::Site::operator()(const Args&... aArgs) const noexcept
+{
+    NoExcept([&]()
+        {
+            const int64_t time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+
+            // Reused, so a record costs no allocation once the buffer has grown
+            thread_local std::string tl_record;
+            tl_record.clear();
+
+            tl_record += cRecordTag;
+            AppendRaw(tl_record, _site.id);
+            AppendRaw(tl_record, time);
+            AppendRaw(tl_record, uint32_t(0)); // arguments size, filled in by Write
+            (AppendArg(tl_record, aArgs), ...);
+
+            Write(_site, tl_record);
+        },
+        MOO_WHERE);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// private:
+
+template<class T>
+void moo::BinaryLogger::AppendRaw(std::string& aBuffer, const T& aValue)
+{
+    static_assert(std::is_trivially_copyable_v<T>);
+
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, &aValue, sizeof(T));
+    aBuffer.append(bytes, sizeof(T));
+}
+
+template<class T>
+void moo::BinaryLogger::AppendArg(std::string& aBuffer, const T& aValue)
+{
+    if constexpr (std::same_as<T, bool>)
+    {
+        aBuffer += static_cast<char>(ArgType::Bool);
+        aBuffer += static_cast<char>(aValue);
+    }
+    else if constexpr (std::same_as<T, char>)
+    {
+        aBuffer += static_cast<char>(ArgType::Char);
+        aBuffer += aValue;
+    }
+    else if constexpr (std::signed_integral<T>)
+    {
+        aBuffer += static_cast<char>(ArgType::Int64);
+        AppendRaw(aBuffer, static_cast<int64_t>(aValue));
+    }
+    else if constexpr (std::unsigned_integral<T>)
+    {
+        aBuffer += static_cast<char>(ArgType::UInt64);
+        AppendRaw(aBuffer, static_cast<uint64_t>(aValue));
+    }
+    else if constexpr (std::floating_point<T>)
+    {
+        aBuffer += static_cast<char>(ArgType::Double);
+        AppendRaw(aBuffer, static_cast<double>(aValue));
+    }
+    else if constexpr (std::is_enum_v<T>)
+    {
+        AppendArg(aBuffer, static_cast<std::underlying_type_t<T>>(aValue));
+    }
+    else
+    {
+        static_assert(std::is_convertible_v<const T&, std::string_view>,
+            "MOO_BLOG takes bools, characters, numbers, enums and strings");
+
+        const std::string_view str = aValue;
+        aBuffer += static_cast<char>(ArgType::String);
+        AppendRaw(aBuffer, static_cast<uint32_t>(str.size()));
+        aBuffer += str;
+    }
+}
@@ -0,0 +1,267 @@
+#include "FlightRecorder.h"
+
+#include "LogSite.h"
+#include "NoExcept.hpp"
+#include "ScopedArray.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+using namespace std;
+using namespace moo;
+
+namespace {
+    using TimePoint = chrono::system_clock::time_point;
+
+    // What is copied in front of the text of every record
+    struct Header {
+        TimePoint::rep time;
+        uint32_t site;
+        uint32_t size;
+    };
+
+    // The records of one thread, back to back in a byte ring, a record wrapping around the end when it has to
+    class Ring {
+    public:
+        explicit Ring(size_t aBytes);
+        MOO_DELETE_DEFAULTS(Ring);
+
+        void Push(TimePoint aTime, uint32_t aSite, string_view aText);
+        void TakeAll(vector<FlightRecorder::Entry>& aEntries);
+
+        [[nodiscard]] size_t Capacity() const noexcept { return _buffer.size(); }
+        [[nodiscard]] bool Empty() noexcept;
+
+    private:
+        void Write(const void* apData, size_t aSize) noexcept;
+        void Read(size_t aOffset, void* apData, size_t aSize) const noexcept;
+        void PopOldest() noexcept;
+
+        mutex _mutex; // only contended while the rings are taken
+        ScopedArray<char> _buffer;
+        size_t _head = 0; // offset of the oldest record
+        size_t _used = 0;
+    };
+
+    constexpr size_t cMaxRetiredRings = 8;
+
+    mutex s_ringsMutex;
+    vector<Ring*> s_rings;
+    // The rings of the threads that ended with records in them, newest last
+    deque<unique_ptr<Ring>> s_retiredRings;
+    atomic<size_t> s_threadBytes = 0;
+
+    // The ring of the calling thread, registered while the thread lives
+    class ThreadRing {
+    public:
+        ThreadRing() = default;
+        ~ThreadRing();
+        MOO_DELETE_DEFAULTS(ThreadRing);
+
+        // nullptr when the recorder is off
+        Ring* Get();
+
+    private:
+        // Keeps the records of an ending thread until the next Take
+        void Release(bool aRetire) noexcept;
+
+        unique_ptr<Ring> _ring;
+    };
+
+    thread_local ThreadRing tl_ring;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+//static
+void FlightRecorder::ThreadBytes(size_t aBytes) noexcept
+{
+    s_threadBytes.store(aBytes, memory_order_relaxed);
+    s_on.store(aBytes != 0, memory_order_relaxed);
+}
+
+//static
+size_t FlightRecorder::ThreadBytes() noexcept
+{
+    return s_threadBytes.load(memory_order_relaxed);
+}
+
+//static
+void FlightRecorder::Record(const LogSite& aSite, string_view aMessage) noexcept
+{
+    NoExcept([&]()
+        {
+            if (Ring* pRing = tl_ring.Get())
+            {
+                pRing->Push(chrono::system_clock::now(), aSite.id, aMessage);
+            }
+        },
+        MOO_WHERE);
+}
+
+//static
+vector<FlightRecorder::Entry> FlightRecorder::Take()
+{
+    vector<Entry> entries;
+
+    {
+        scoped_lock lock(s_ringsMutex);
+
+        for (Ring* pRing : s_rings)
+        {
+            pRing->TakeAll(entries);
+        }
+
+        for (const unique_ptr<Ring>& pRing : s_retiredRings)
+        {
+            pRing->TakeAll(entries);
+        }
+
+        s_retiredRings.clear();
+    }
+
+    stable_sort(entries.begin(), entries.end(),
+        [](const Entry& aLeft, const Entry& aRight) { return aLeft.time < aRight.time; });
+
+    return entries;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+namespace {
+    Ring::Ring(size_t aBytes)
+        : _buffer(max(aBytes, 2 * sizeof(Header)), cForOverwrite)
+    {
+    }
+
+    void Ring::Push(TimePoint aTime, uint32_t aSite, string_view aText)
+    {
+        // A record larger than the ring keeps its beginning
+        const size_t size = min(aText.size(), Capacity() - sizeof(Header));
+        const Header header{ aTime.time_since_epoch().count(), aSite, static_cast<uint32_t>(size) };
+
+        scoped_lock lock(_mutex);
+
+        while (Capacity() - _used < sizeof(Header) + size)
+        {
+            PopOldest();
+        }
+
+        Write(&header, sizeof(Header));
+        Write(aText.data(), size);
+    }
+
+    void Ring::TakeAll(vector<FlightRecorder::Entry>& aEntries)
+    {
+        scoped_lock lock(_mutex);
+
+        while (_used != 0)
+        {
+            Header header;
+            Read(_head, &header, sizeof(Header));
+
+            FlightRecorder::Entry& entry = aEntries.emplace_back();
+            entry.time = TimePoint(TimePoint::duration(header.time));
+            entry.site = header.site;
+            entry.text.resize(header.size);
+            Read(_head + sizeof(Header), entry.text.data(), header.size);
+
+            PopOldest();
+        }
+    }
+
+    bool Ring::Empty() noexcept
+    {
+        scoped_lock lock(_mutex);
+        return _used == 0;
+    }
+
+    // private:
+
+    void Ring::Write(const void* apData, size_t aSize) noexcept
+    {
+        const size_t offset = (_head + _used) % Capacity();
+        const size_t first = min(aSize, Capacity() - offset);
+
+        memcpy(_buffer.data() + offset, apData, first);
+        memcpy(_buffer.data(), static_cast<const char*>(apData) + first, aSize - first);
+        _used += aSize;
+    }
+
+    void Ring::Read(size_t aOffset, void* apData, size_t aSize) const noexcept
+    {
+        const size_t offset = aOffset % Capacity();
+        const size_t first = min(aSize, Capacity() - offset);
+
+        memcpy(apData, _buffer.data() + offset, first);
+        memcpy(static_cast<char*>(apData) + first, _buffer.data(), aSize - first);
+    }
+
+    void Ring::PopOldest() noexcept
+    {
+        Header header;
+        Read(_head, &header, sizeof(Header));
+
+        const size_t size = sizeof(Header) + header.size;
+        _head = (_head + size) % Capacity();
+        _used -= size;
+    }
+
+    //------------------------------------------------------------------------------------------------------------------
+
+    ThreadRing::~ThreadRing()
+    {
+        Release(true);
+    }
+
+    Ring* ThreadRing::Get()
+    {
+        const size_t bytes = s_threadBytes.load(memory_order_relaxed);
+
+        if (bytes != 0 && _ring && _ring->Capacity() == max(bytes, 2 * sizeof(Header)))
+        {
+            return _ring.get();
+        }
+
+        Release(false);
+
+        if (bytes == 0)
+        {
+            return nullptr;
+        }
+
+        _ring = make_unique<Ring>(bytes);
+
+        scoped_lock lock(s_ringsMutex);
+        s_rings.push_back(_ring.get());
+        return _ring.get();
+    }
+
+    // private:
+
+    void ThreadRing::Release(bool aRetire) noexcept
+    {
+        if (!_ring)
+        {
+            return;
+        }
+
+        scoped_lock lock(s_ringsMutex);
+        erase(s_rings, _ring.get());
+
+        if (aRetire && !_ring->Empty())
+        {
+            if (s_retiredRings.size() == cMaxRetiredRings)
+            {
+                s_retiredRings.pop_front();
+            }
+
+            s_retiredRings.push_back(move(_ring));
+        }
+
+        _ring.reset();
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include "MooDefaults.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace moo {
+    struct LogSite;
+
+    // The last records of the log sites of every thread (see MOO_LOG), kept in memory only, at every level:
+    // while it's on, sites below LogSite::MinLevel run too, but their messages only go here.
+    // Each thread copies its records into a ring of its own, dropping the oldest ones when it's full, so a record
+    // costs about a memcpy and an uncontended lock. The rings of the last few threads that ended are kept too.
+    // Logger::DumpFlightRecorder writes them to the log, which it does when NoExcept catches an exception,
+    // when a line is written to cerr, or when asked to.
+    class FlightRecorder {
+    public:
+        struct Entry {
+            std::chrono::system_clock::time_point time;
+            uint32_t site = 0; // LogSite id
+            std::string text;
+        };
+
+        MOO_DELETE_DEFAULTS(FlightRecorder);
+
+        // Bytes kept for every thread, 0 (the default) turns the recorder off.
+        // A thread starts over with a new ring at its next record after it changes.
+        static void ThreadBytes(size_t aBytes) noexcept;
+        [[nodiscard]] static size_t ThreadBytes() noexcept;
+
+        [[nodiscard]] static bool On() noexcept
+        {
+            return s_on.load(std::memory_order_relaxed);
+        }
+
+        // Adds a message of aSite to the ring of the calling thread
+        static void Record(const LogSite& aSite, std::string_view aMessage) noexcept;
+
+        // The records of all the threads, oldest first, leaving the rings empty
+        [[nodiscard]] static std::vector<Entry> Take();
+
+    private:
+        static inline std::atomic<bool> s_on = false;
+    };
+}
@@ -0,0 +1,330 @@
+#pragma once
+
+#include "MooDefaults.h"
+#include "MooWarning.h"
+#include "ScopedArray.hpp"
+
+#include <memory>
+#include <span>
+#include <utility>
+
+namespace moo {
+    // A ScopedArray that keeps up to cInlineSize elements in itself, and only allocates above that,
+    // for the many arrays of just a few elements.
+    // Moving it moves the elements one by one while they are inline.
+    template<class T, size_t cInlineSize>
+    class InlineArray {
+        static_assert(cInlineSize > 0, "an InlineArray keeps at least one element inline");
+
+    public:
+        using Type = T;
+        using Iterator = SpanIterator<T>;
+        using ConstIterator = SpanIterator<const T>;
+
+        static constexpr size_t cCapacity = cInlineSize;
+
+        InlineArray() noexcept = default;
+        ~InlineArray();
+        explicit InlineArray(size_t aSize);
+        InlineArray(size_t aSize, ForOverwrite);
+        template<class Range> requires AssignableRange<InlineArray, T, Range>
+        explicit InlineArray(Range&& aRange);
+        // Like ScopedArray::operator=
+        template<class Range> requires AssignableRange<InlineArray, T, Range>
+        InlineArray& operator=(Range&& aRange);
+
+        InlineArray(InlineArray&& aOther) noexcept(std::is_nothrow_move_constructible_v<T>);
+        InlineArray& operator=(InlineArray&& aOther) noexcept(std::is_nothrow_move_constructible_v<T>);
+        InlineArray(const InlineArray&) = delete;
+        InlineArray& operator=(const InlineArray&) = delete;
+
+        [[nodiscard]] constexpr Iterator begin() noexcept { return begin<T>(this); }
+        [[nodiscard]] constexpr ConstIterator begin() const noexcept { return begin<const T>(this); }
+
+        [[nodiscard]] constexpr Iterator end() noexcept { return end<T>(this); }
+        [[nodiscard]] constexpr ConstIterator end() const noexcept { return end<const T>(this); }
+
+        [[nodiscard]] constexpr T& operator[](size_t aIndex) noexcept;
+        [[nodiscard]] constexpr const T& operator[](size_t aIndex) const noexcept;
+
+        [[nodiscard]] constexpr size_t size() const noexcept;
+
+        [[nodiscard]] constexpr T* data() noexcept;
+        [[nodiscard]] constexpr const T* data() const noexcept;
+
+        // Whether the elements are kept in the array itself
+        [[nodiscard]] constexpr bool Inline() const noexcept;
+
+        void reset() noexcept;
+        // Value-initializes the elements
+        void Reset(size_t aSize = 0);
+        void Reset(size_t aSize, ForOverwrite);
+
+        [[nodiscard]] constexpr std::span<const char> CBytes() const noexcept;
+        [[nodiscard]] constexpr std::span<const unsigned char> CUBytes() const noexcept;
+
+    private:
+        // Replaces the elements with aSize new ones, which aConstruct(T* apData) constructs.
+        // The ones that fit inline are constructed aside and moved in.
+        template<class Construct>
+        void Allocate(size_t aSize, Construct&& aConstruct);
+        // Destroys the elements, leaving the array empty
+        void Release() noexcept;
+        // Takes the elements of aOther, leaving it empty
+        void Take(InlineArray& aOther) noexcept(std::is_nothrow_move_constructible_v<T>);
+
+        [[nodiscard]] T* InlineData() noexcept;
+        [[nodiscard]] const T* InlineData() const noexcept;
+
+        template<class Tv, class TSelf>
+        [[nodiscard]] static constexpr SpanIterator<Tv> begin(TSelf* apSelf) noexcept;
+        template<class Tv, class TSelf>
+        [[nodiscard]] static constexpr SpanIterator<Tv> end(TSelf* apSelf) noexcept;
+
+        T* _pHeap = nullptr; // only above cInlineSize elements
+        size_t _size = 0;
+        alignas(T) unsigned char _inline[cInlineSize * sizeof(T)];
+    };
+}
+
+template<class T, size_t cInlineSize>
+moo::InlineArray<T, cInlineSize>::~InlineArray()
+{
+    Release();
+}
+
+template<class T, size_t cInlineSize>
+moo::InlineArray<T, cInlineSize>::InlineArray(size_t aSize)
+{
+    Reset(aSize);
+}
+
+template<class T, size_t cInlineSize>
+moo::InlineArray<T, cInlineSize>::InlineArray(size_t aSize, ForOverwrite)
+{
+    Reset(aSize, cForOverwrite);
+}
+
+template<class T, size_t cInlineSize>
+template<class Range>
+    requires moo::AssignableRange<moo::InlineArray<T, cInlineSize>, T, Range>
+moo::InlineArray<T, cInlineSize>::InlineArray(Range&& aRange)
+{
+    *this = std::forward<Range>(aRange);
+}
+
+template<class T, size_t cInlineSize>
+template<class Range>
+    requires moo::AssignableRange<moo::InlineArray<T, cInlineSize>, T, Range>
+moo::InlineArray<T, cInlineSize>& moo::InlineArray<T, cInlineSize>::operator=(Range&& aRange)
+{
+    const size_t size = static_cast<size_t>(std::ranges::size(aRange));
+
+    if (size == _size)
+    {
+        AssignRangeElements(data(), std::forward<Range>(aRange));
+    }
+    else
+    {
+        Allocate(size, [&](T* apData) { ConstructRangeElements(apData, std::forward<Range>(aRange)); });
+    }
+
+    return *this;
+}
+
+template<class T, size_t cInlineSize>
+moo::InlineArray<T, cInlineSize>::InlineArray(InlineArray&& aOther)
+    noexcept(std::is_nothrow_move_constructible_v<T>)
+{
+    Take(aOther);
+}
+
+template<class T, size_t cInlineSize>
+moo::InlineArray<T, cInlineSize>& moo::InlineArray<T, cInlineSize>::operator=(InlineArray&& aOther)
+    noexcept(std::is_nothrow_move_constructible_v<T>)
+{
+    if (this != &aOther)
+    {
+        Release();
+        Take(aOther);
+    }
+
+    return *this;
+}
+
+template<class T, size_t cInlineSize>
+[[nodiscard]] constexpr T& moo::InlineArray<T, cInlineSize>::operator[](size_t aIndex) noexcept
+{
+    MOO_RETURN_RANDOM_ACCESS(data(), aIndex, _size);
+}
+template<class T, size_t cInlineSize>
+[[nodiscard]] constexpr const T& moo::InlineArray<T, cInlineSize>::operator[](size_t aIndex) const noexcept
+{
+    MOO_RETURN_RANDOM_ACCESS(data(), aIndex, _size);
+}
+
+template<class T, size_t cInlineSize>
+[[nodiscard]] constexpr size_t moo::InlineArray<T, cInlineSize>::size() const noexcept
+{
+    return _size;
+}
+
+template<class T, size_t cInlineSize>
+[[nodiscard]] constexpr T* moo::InlineArray<T, cInlineSize>::data() noexcept
+{
+    return _pHeap ? _pHeap : InlineData();
+}
+template<class T, size_t cInlineSize>
+[[nodiscard]] constexpr const T* moo::InlineArray<T, cInlineSize>::data() const noexcept
+{
+    return _pHeap ? _pHeap : InlineData();
+}
+
+template<class T, size_t cInlineSize>
+[[nodiscard]] constexpr bool moo::InlineArray<T, cInlineSize>::Inline() const noexcept
+{
+    return _pHeap == nullptr;
+}
+
+template<class T, size_t cInlineSize>
+void moo::InlineArray<T, cInlineSize>::reset() noexcept
+{
+    Release();
+}
+template<class T, size_t cInlineSize>
+void moo::InlineArray<T, cInlineSize>::Reset(size_t aSize)
+{
+    Allocate(aSize, [aSize](T* apData) { std::uninitialized_value_construct_n(apData, aSize); });
+}
+template<class T, size_t cInlineSize>
+void moo::InlineArray<T, cInlineSize>::Reset(size_t aSize, ForOverwrite)
+{
+    Allocate(aSize, [aSize](T* apData) { std::uninitialized_default_construct_n(apData, aSize); });
+}
+
+template<class T, size_t cInlineSize>
+[[nodiscard]] constexpr std::span<const char> moo::InlineArray<T, cInlineSize>::CBytes() const noexcept
+{
+    return { reinterpret_cast<const char*>(data()), _size * sizeof(T) };
+}
+template<class T, size_t cInlineSize>
+[[nodiscard]] constexpr std::span<const unsigned char> moo::InlineArray<T, cInlineSize>::CUBytes() const noexcept
+{
+    return { reinterpret_cast<const unsigned char*>(data()), _size * sizeof(T) };
+}
+
+//-------------------------------------------------------------------------------------------------------
+// private:
+
+template<class T, size_t cInlineSize>
+template<class Construct>
+void moo::InlineArray<T, cInlineSize>::Allocate(size_t aSize, Construct&& aConstruct)
+{
+    if (aSize <= cInlineSize)
+    {
+        // Built aside, so the old elements are still there when it throws or when they are what's assigned
+        alignas(T) unsigned char buffer[sizeof(_inline)];
+        T* pNew = std::launder(reinterpret_cast<T*>(buffer));
+        aConstruct(pNew);
+
+        Release();
+
+        try
+        {
+            std::uninitialized_move_n(pNew, aSize, InlineData());
+        }
+        catch (...)
+        {
+            std::destroy_n(pNew, aSize);
+            throw;
+        }
+
+        std::destroy_n(pNew, aSize);
+        _size = aSize;
+        return;
+    }
+
+    std::allocator<T> allocator;
+    T* pData = allocator.allocate(aSize);
+
+    try
+    {
+        aConstruct(pData);
+    }
+    catch (...)
+    {
+        allocator.deallocate(pData, aSize);
+        throw;
+    }
+
+    Release();
+
+    _pHeap = pData;
+    _size = aSize;
+}
+
+template<class T, size_t cInlineSize>
+void moo::InlineArray<T, cInlineSize>::Release() noexcept
+{
+    std::destroy_n(data(), _size);
+
+    if (_pHeap)
+    {
+        std::allocator<T>().deallocate(_pHeap, _size);
+        _pHeap = nullptr;
+    }
+
+    _size = 0;
+}
+
+template<class T, size_t cInlineSize>
+void moo::InlineArray<T, cInlineSize>::Take(InlineArray& aOther) noexcept(std::is_nothrow_move_constructible_v<T>)
+{
+    if (aOther._pHeap)
+    {
+        _pHeap = std::exchange(aOther._pHeap, nullptr);
+        _size = std::exchange(aOther._size, 0);
+        return;
+    }
+
+    std::uninitialized_move_n(aOther.InlineData(), aOther._size, InlineData());
+    _size = aOther._size;
+    aOther.Release();
+}
+
+template<class T, size_t cInlineSize>
+[[nodiscard]] T* moo::InlineArray<T, cInlineSize>::InlineData() noexcept
+{
+    return std::launder(reinterpret_cast<T*>(_inline));
+}
+template<class T, size_t cInlineSize>
+[[nodiscard]] const T* moo::InlineArray<T, cInlineSize>::InlineData() const noexcept
+{
+    return std::launder(reinterpret_cast<const T*>(_inline));
+}
+
+template<class T, size_t cInlineSize>
+template<class Tv, class TSelf>
+[[nodiscard]] constexpr moo::SpanIterator<Tv> moo::InlineArray<T, cInlineSize>::begin(TSelf* apSelf) noexcept
+{
+    Tv* ptr = apSelf->data();
+#if MOO_ITERATOR_DEBUG_LEVEL >= 1
+    MOO_SUPPRESS(26481); // Don't use pointer arithmetic. Use span instead
+    return { ptr, ptr, ptr + apSelf->_size };
+#else
+    return { ptr };
+#endif
+}
+template<class T, size_t cInlineSize>
+template<class Tv, class TSelf>
+[[nodiscard]] constexpr moo::SpanIterator<Tv> moo::InlineArray<T, cInlineSize>::end(TSelf* apSelf) noexcept
+{
+    Tv* ptr = apSelf->data();
+    MOO_SUPPRESS(26481); // Don't use pointer arithmetic. Use span instead
+    Tv* end = ptr + apSelf->_size;
+#if MOO_ITERATOR_DEBUG_LEVEL >= 1
+    return { end, ptr, end };
+#else
+    return { end };
+#endif
+}
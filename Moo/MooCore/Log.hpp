@@ -0,0 +1,97 @@
+#pragma once
+#include "FlightRecorder.h"
+#include "LogFormat.hpp"
+#include "LogSite.h"
+#include "Logger.h"
+#include "NoExcept.hpp"
+
+#include <sstream>
+
+// Logs "{}" formatted text through the Logger, e.g. MOO_LOG(Warn, "{} retries left", retries);
+// A_LEVEL is a LogLevel name. Errors go where cerr goes, the other levels where clog goes.
+// The arguments are only evaluated when the site is enabled, see LogSite, or the FlightRecorder is on.
+#define MOO_LOG(A_LEVEL, A_FORMAT, ...) \
+    MOO_IF_LOG_SITE_ENABLED_OR_RECORDED(A_LEVEL, A_FORMAT, moo::LogStatement{s_mooLogSite}(__VA_ARGS__))
+
+// A disabled site still runs while the FlightRecorder is on, Logger::Write then only records its message
+#define MOO_IF_LOG_SITE_ENABLED_OR_RECORDED(A_LEVEL, A_FORMAT, A_STATEMENT) \
+    MOO_IF_LOG_SITE(A_LEVEL, A_FORMAT, \
+        s_mooLogSite.Enabled() ? s_mooLogSite.Admit() : moo::FlightRecorder::On(), A_STATEMENT)
+
+#define MOO_TRACE(A_FORMAT, ...) MOO_LOG(Trace, A_FORMAT, __VA_ARGS__)
+#define MOO_DEBUG(A_FORMAT, ...) MOO_LOG(Debug, A_FORMAT, __VA_ARGS__)
+#define MOO_INFO(A_FORMAT, ...) MOO_LOG(Info, A_FORMAT, __VA_ARGS__)
+#define MOO_WARN(A_FORMAT, ...) MOO_LOG(Warn, A_FORMAT, __VA_ARGS__)
+#define MOO_ERROR(A_FORMAT, ...) MOO_LOG(Error, A_FORMAT, __VA_ARGS__)
+
+// Like MOO_LOG, but the number of arguments is checked against the "{}" of A_FORMAT when it's compiled,
+// and they are formatted straight into the record with std::to_chars, without iostreams (see AppendLogArg).
+// The arguments have to be LogFormattable.
+#define MOO_LOGF(A_LEVEL, A_FORMAT, ...) \
+    MOO_IF_LOG_SITE_ENABLED_OR_RECORDED(A_LEVEL, A_FORMAT, \
+        moo::LogStatementF<moo::CountLogFormatArgs(A_FORMAT)>{s_mooLogSite}(__VA_ARGS__))
+
+#define MOO_TRACEF(A_FORMAT, ...) MOO_LOGF(Trace, A_FORMAT, __VA_ARGS__)
+#define MOO_DEBUGF(A_FORMAT, ...) MOO_LOGF(Debug, A_FORMAT, __VA_ARGS__)
+#define MOO_INFOF(A_FORMAT, ...) MOO_LOGF(Info, A_FORMAT, __VA_ARGS__)
+#define MOO_WARNF(A_FORMAT, ...) MOO_LOGF(Warn, A_FORMAT, __VA_ARGS__)
+#define MOO_ERRORF(A_FORMAT, ...) MOO_LOGF(Error, A_FORMAT, __VA_ARGS__)
+
+namespace moo {
+    // What MOO_LOG calls with the arguments
+    class LogStatement {
+    public:
+        explicit LogStatement(const LogSite& aSite) noexcept : _site(aSite) {}
+
+        template<class... Args>
+        void operator()(const Args&... aArgs) const noexcept;
+
+    private:
+        const LogSite& _site;
+    };
+
+    // What MOO_LOGF calls with the arguments, cArgCount being the number of "{}" in the format
+    template<size_t cArgCount>
+    class LogStatementF {
+    public:
+        explicit LogStatementF(const LogSite& aSite) noexcept : _site(aSite) {}
+
+        template<LogFormattable... Args>
+        void operator()(const Args&... aArgs) const noexcept;
+
+    private:
+        const LogSite& _site;
+    };
+}
+
+template<class... Args>
+void moo::LogStatement::operator()(const Args&... aArgs) const noexcept
+{
+    NoExcept([&]()
+        {
+            thread_local std::ostringstream tl_message;
+            tl_message.str({});
+
+            WriteLogFormat(tl_message, _site.format, aArgs...);
+            Logger::Write(_site, tl_message.view());
+        },
+        MOO_WHERE);
+}
+
+template<size_t cArgCount>
+template<moo::LogFormattable... Args>
+void moo::LogStatementF<cArgCount>::operator()(const Args&... aArgs) const noexcept
+{
+    static_assert(sizeof...(Args) == cArgCount, "MOO_LOGF takes one argument for each {} of its format");
+
+    NoExcept([&]()
+        {
+            // Keeps its capacity, so formatting doesn't allocate once it's big enough
+            thread_local std::string tl_message;
+            tl_message.clear();
+
+            AppendLogFormat(tl_message, _site.format, aArgs...);
+            Logger::Write(_site, tl_message);
+        },
+        MOO_WHERE);
+}
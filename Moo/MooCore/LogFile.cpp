@@ -0,0 +1,378 @@
+#include "LogFile.h"
+
+#include "MappedFile.h"
+#include "NoExcept.hpp"
+
+#include <fstream>
+#include <optional>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+using namespace moo;
+
+namespace moo {
+    // One open log file, an ofstream or a MappedFile
+    class SingleLogFile {
+    public:
+        SingleLogFile(filesystem::path aPath, bool aAppend, const LogFileOptions& aOptions);
+        ~SingleLogFile();
+        MOO_DELETE_DEFAULTS(SingleLogFile);
+
+        void Write(string_view aStr);
+        void Flush();
+        void Sync();
+        [[nodiscard]] const filesystem::path& Path() const noexcept;
+
+    private:
+        filesystem::path _path;
+        ofstream _stream;
+        unique_ptr<MappedFile> _pMapped;
+
+        // An ofstream has no handle to sync, so another one to the same file is opened the first time it's needed
+#ifdef _WIN32
+        HANDLE _syncHandle = INVALID_HANDLE_VALUE;
+#else
+        int _syncFd = -1;
+#endif
+    };
+}
+
+namespace {
+    // The number of a rotated file named <aStem>.<number><aExtension>
+    optional<uint64_t> FileNumber(const filesystem::path& aFile, const string& aStem, const string& aExtension)
+    {
+        const string name = aFile.filename().string();
+
+        if (name.size() <= aStem.size() + 1 + aExtension.size()
+            || !name.starts_with(aStem + ".")
+            || !name.ends_with(aExtension))
+        {
+            return nullopt;
+        }
+
+        const string digits = name.substr(aStem.size() + 1, name.size() - aStem.size() - 1 - aExtension.size());
+
+        if (digits.find_first_not_of("0123456789") != string::npos)
+        {
+            return nullopt;
+        }
+
+        return stoull(digits);
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+SingleLogFile::SingleLogFile(filesystem::path aPath, bool aAppend, const LogFileOptions& aOptions)
+    : _path(move(aPath))
+{
+    if (!aOptions.mapped)
+    {
+        _stream.open(_path, aAppend ? ios::app : ios::trunc);
+        return;
+    }
+
+    _pMapped = make_unique<MappedFile>(_path.string(), aAppend);
+    _pMapped->SyncEvery(aOptions.syncBytes);
+}
+
+SingleLogFile::~SingleLogFile()
+{
+#ifdef _WIN32
+    if (_syncHandle != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(_syncHandle);
+    }
+#else
+    if (_syncFd >= 0)
+    {
+        close(_syncFd);
+    }
+#endif
+}
+
+void SingleLogFile::Write(string_view aStr)
+{
+    if (_pMapped)
+    {
+        _pMapped->Write(aStr);
+    }
+    else
+    {
+        _stream << aStr;
+    }
+}
+
+void SingleLogFile::Flush()
+{
+    // The mapping is already the OS cache
+    if (!_pMapped)
+    {
+        _stream.flush();
+    }
+}
+
+void SingleLogFile::Sync()
+{
+    if (_pMapped)
+    {
+        _pMapped->Sync();
+        return;
+    }
+
+    _stream.flush();
+
+#ifdef _WIN32
+    if (_syncHandle == INVALID_HANDLE_VALUE)
+    {
+        _syncHandle = CreateFileW(_path.c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+            nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    }
+
+    if (_syncHandle != INVALID_HANDLE_VALUE)
+    {
+        FlushFileBuffers(_syncHandle);
+    }
+#else
+    if (_syncFd < 0)
+    {
+        _syncFd = open(_path.c_str(), O_WRONLY | O_CLOEXEC);
+    }
+
+    if (_syncFd >= 0)
+    {
+#ifdef __linux__
+        fdatasync(_syncFd);
+#else
+        fsync(_syncFd);
+#endif
+    }
+#endif
+}
+
+const filesystem::path& SingleLogFile::Path() const noexcept
+{
+    return _path;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+LogFile::LogFile(const string& aPath, bool aAppend, LogFileOptions aOptions)
+    : _options(move(aOptions))
+    , _path(aPath)
+    , _openedAt(chrono::steady_clock::now())
+{
+    if (!_options.rotation.Enabled())
+    {
+        _pFile = make_unique<SingleLogFile>(_path, aAppend, _options);
+        return;
+    }
+
+    const uint64_t highest = HighestNumber();
+    const bool append = aAppend && highest > 0;
+
+    _number = append ? highest : highest + 1;
+    _pFile = make_unique<SingleLogFile>(NumberedPath(_number), append, _options);
+
+    if (append)
+    {
+        error_code error;
+        const uintmax_t size = filesystem::file_size(_pFile->Path(), error);
+        _bytes = error ? 0 : static_cast<uint64_t>(size);
+    }
+
+    _retired = async(launch::async, [this, current = _number]() { RemoveOldFiles(current); });
+    OpenNextInBackground();
+}
+
+LogFile::~LogFile()
+{
+    NoExcept([&]()
+        {
+            if (_retired.valid())
+            {
+                _retired.wait();
+            }
+
+            if (_next.valid())
+            {
+                // It was opened ahead of time and never used
+                unique_ptr<SingleLogFile> pNext = _next.get();
+                const filesystem::path path = pNext->Path();
+                pNext.reset();
+
+                error_code error;
+                filesystem::remove(path, error);
+            }
+        },
+        MOO_WHERE);
+}
+
+void LogFile::Write(string_view aStr)
+{
+    if (aStr.empty())
+    {
+        return;
+    }
+
+    if (_atLineStart && _options.rotation.Enabled() && RotationDue())
+    {
+        Rotate();
+    }
+
+    _pFile->Write(aStr);
+    _bytes += aStr.size();
+    _atLineStart = aStr.back() == '\n';
+}
+
+void LogFile::Flush()
+{
+    _pFile->Flush();
+}
+
+void LogFile::Sync()
+{
+    _pFile->Sync();
+
+    // What was written before the last rotations is in the files still being retired, which sync them
+    if (_retired.valid())
+    {
+        _retired.wait();
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// private:
+
+bool LogFile::RotationDue() const noexcept
+{
+    if (_bytes == 0)
+    {
+        return false;
+    }
+
+    const LogRotation& rotation = _options.rotation;
+
+    if (rotation.maxBytes > 0 && _bytes >= rotation.maxBytes)
+    {
+        return true;
+    }
+
+    return rotation.interval.count() > 0 && chrono::steady_clock::now() - _openedAt >= rotation.interval;
+}
+
+void LogFile::Rotate()
+{
+    if (!_next.valid())
+    {
+        // Opening it failed last time, try again
+        OpenNextInBackground();
+    }
+
+    // The writer may hold the Logger::Lock, so it doesn't wait for the next file: it tries again at the next line.
+    // Unless a burst got the file far past its size, then waiting for one open is better than growing without end.
+    const uint64_t maxBytes = _options.rotation.maxBytes;
+    const bool overdue = maxBytes > 0 && _bytes >= 2 * maxBytes;
+
+    if (!overdue && _next.wait_for(chrono::seconds(0)) != future_status::ready)
+    {
+        return;
+    }
+
+    unique_ptr<SingleLogFile> pNext = _next.get();
+
+    // Chained after the retiring of the previous files, which may still be going on, so they are removed in order
+    // and _retired stands for all of them
+    _retired = async(launch::async,
+        [this, previous = move(_retired), pPrevious = move(_pFile), current = _number + 1]() mutable
+        {
+            if (previous.valid())
+            {
+                previous.wait();
+            }
+
+            // Closing doesn't make it durable, and the lines since the last Sync are only in this file
+            pPrevious->Sync();
+            pPrevious.reset();
+            RemoveOldFiles(current);
+        });
+
+    _pFile = move(pNext);
+    ++_number;
+    _bytes = 0;
+    _openedAt = chrono::steady_clock::now();
+
+    OpenNextInBackground();
+}
+
+void LogFile::OpenNextInBackground()
+{
+    _next = async(launch::async, [path = NumberedPath(_number + 1), options = _options]()
+        {
+            return make_unique<SingleLogFile>(path, false, options);
+        });
+}
+
+filesystem::path LogFile::NumberedPath(uint64_t aNumber) const
+{
+    return _path.parent_path() / (_path.stem().string() + "." + to_string(aNumber) + _path.extension().string());
+}
+
+uint64_t LogFile::HighestNumber() const
+{
+    const filesystem::path directory = _path.has_parent_path() ? _path.parent_path() : ".";
+    const string stem = _path.stem().string();
+    const string extension = _path.extension().string();
+
+    uint64_t highest = 0;
+    error_code error;
+
+    for (const auto& entry : filesystem::directory_iterator(directory, error))
+    {
+        if (const optional<uint64_t> number = FileNumber(entry.path(), stem, extension))
+        {
+            highest = max(highest, *number);
+        }
+    }
+
+    return highest;
+}
+
+void LogFile::RemoveOldFiles(uint64_t aCurrent) const
+{
+    const size_t keepFiles = _options.rotation.keepFiles;
+
+    if (keepFiles == 0 || aCurrent < keepFiles)
+    {
+        return;
+    }
+
+    const filesystem::path directory = _path.has_parent_path() ? _path.parent_path() : ".";
+    const string stem = _path.stem().string();
+    const string extension = _path.extension().string();
+
+    vector<filesystem::path> oldFiles;
+    error_code error;
+
+    for (const auto& entry : filesystem::directory_iterator(directory, error))
+    {
+        const optional<uint64_t> number = FileNumber(entry.path(), stem, extension);
+
+        if (number && *number <= aCurrent - keepFiles)
+        {
+            oldFiles.push_back(entry.path());
+        }
+    }
+
+    for (const filesystem::path& file : oldFiles)
+    {
+        filesystem::remove(file, error);
+    }
+}
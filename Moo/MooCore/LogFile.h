@@ -0,0 +1,64 @@
+#pragma once
+#include "LogRotation.h"
+#include "MooDefaults.h"
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace moo {
+    struct LogFileOptions {
+        bool mapped = false;   // MappedFile instead of ofstream
+        uint64_t syncBytes = 0; // MappedFile::SyncEvery
+        LogRotation rotation;
+    };
+
+    class SingleLogFile;
+
+    // The file the Logger writes clog and cerr to.
+    // Without rotation it's just the file at aPath. With rotation the log goes to numbered files next to it
+    // (Moo.log becomes Moo.1.log, Moo.2.log...): a new one continues after the highest existing number,
+    // and appending continues the highest one. Files only change at the start of a line.
+    // The next file is opened in the background ahead of time, and the previous one is closed and the oldest ones
+    // removed in the background too, so a rotation only swaps two pointers. If the next file isn't ready yet,
+    // writing goes on in the current one, up to twice the size of a rotation.
+    // A retired file is synced before it's closed, and Sync waits for that.
+    //
+    // Write is not thread safe, the Logger serializes it.
+    class LogFile {
+    public:
+        LogFile(const std::string& aPath, bool aAppend, LogFileOptions aOptions);
+        ~LogFile();
+        MOO_DELETE_DEFAULTS(LogFile);
+
+        void Write(std::string_view aStr);
+        // Hands what was written to the OS
+        void Flush();
+        // Flush, and wait until it's on the disk
+        void Sync();
+
+    private:
+        [[nodiscard]] bool RotationDue() const noexcept;
+        void Rotate();
+        void OpenNextInBackground();
+        [[nodiscard]] std::filesystem::path NumberedPath(uint64_t aNumber) const;
+        [[nodiscard]] uint64_t HighestNumber() const;
+        void RemoveOldFiles(uint64_t aCurrent) const;
+
+        const LogFileOptions _options;
+        const std::filesystem::path _path;
+
+        std::unique_ptr<SingleLogFile> _pFile;
+        uint64_t _number = 0;
+        uint64_t _bytes = 0;
+        bool _atLineStart = true; // lines can arrive in pieces, and they aren't split between files
+        std::chrono::steady_clock::time_point _openedAt;
+
+        std::future<std::unique_ptr<SingleLogFile>> _next;
+        std::future<void> _retired; // syncing and closing the previous files and removing the oldest ones
+    };
+}
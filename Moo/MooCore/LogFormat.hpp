@@ -0,0 +1,187 @@
+#pragma once
+
+#include <charconv>
+#include <concepts>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace moo {
+    // Walks aFormat, calling aText(std::string_view) for the literal text and aArg(i) where argument i goes:
+    // each "{}" is replaced by the next argument, "{{" and "}}" are literal braces, and arguments left over
+    // without a "{}" are appended after a space each.
+    template<class Text, class Arg>
+    constexpr void ForEachLogFormatPart(std::string_view aFormat, size_t aArgCount, Text&& aText, Arg&& aArg);
+
+    // How many "{}" aFormat has, so MOO_LOGF can check its arguments when it's compiled
+    [[nodiscard]] constexpr size_t CountLogFormatArgs(std::string_view aFormat) noexcept;
+
+    // Writes aFormat with its arguments (see ForEachLogFormatPart), each written the way an ostream writes it,
+    // so the text matches what streaming the same values to clog gives.
+    // aWriteArg(aOut, i) writes argument i; it's how the decoder of the binary log, which has no typed
+    // arguments, shares this with MOO_LOG.
+    template<class WriteArg>
+    void WriteLogFormat(std::ostream& aOut, std::string_view aFormat, size_t aArgCount, WriteArg&& aWriteArg);
+
+    template<class... Args>
+    void WriteLogFormat(std::ostream& aOut, std::string_view aFormat, const Args&... aArgs);
+
+    // What MOO_LOGF formats without iostreams
+    template<class T>
+    concept LogFormattable = std::is_arithmetic_v<T> || std::is_enum_v<T> || std::is_pointer_v<T>
+        || std::convertible_to<const T&, std::string_view>;
+
+    // Appends aValue: bool as true/false, char as itself, other numbers and enums through std::to_chars
+    // (floating point in the shortest form that reads back the same value), strings as they are,
+    // and other pointers in hex
+    template<LogFormattable T>
+    void AppendLogArg(std::string& aOut, const T& aValue);
+
+    // Like WriteLogFormat, but appends to a string with AppendLogArg
+    template<LogFormattable... Args>
+    void AppendLogFormat(std::string& aOut, std::string_view aFormat, const Args&... aArgs);
+}
+
+template<class Text, class Arg>
+constexpr void moo::ForEachLogFormatPart(std::string_view aFormat, size_t aArgCount, Text&& aText, Arg&& aArg)
+{
+    size_t arg = 0;
+    size_t pos = 0;
+
+    while (pos < aFormat.size())
+    {
+        // Everything up to the next brace at once
+        const size_t brace = aFormat.find_first_of("{}", pos);
+        aText(aFormat.substr(pos, brace - pos));
+
+        if (brace == std::string_view::npos)
+        {
+            break;
+        }
+
+        pos = brace;
+        const std::string_view two = aFormat.substr(pos, 2);
+
+        if (two == "{{" || two == "}}")
+        {
+            aText(aFormat.substr(pos, 1));
+            pos += 2;
+        }
+        else if (two == "{}" && arg < aArgCount)
+        {
+            aArg(arg++);
+            pos += 2;
+        }
+        else
+        {
+            aText(aFormat.substr(pos, 1));
+            ++pos;
+        }
+    }
+
+    for (; arg < aArgCount; ++arg)
+    {
+        aText(" ");
+        aArg(arg);
+    }
+}
+
+constexpr size_t moo::CountLogFormatArgs(std::string_view aFormat) noexcept
+{
+    size_t count = 0;
+
+    for (size_t pos = 0; pos + 1 < aFormat.size(); ++pos)
+    {
+        const std::string_view two = aFormat.substr(pos, 2);
+
+        if (two == "{}")
+        {
+            ++count;
+            ++pos;
+        }
+        else if (two == "{{" || two == "}}")
+        {
+            ++pos;
+        }
+    }
+
+    return count;
+}
+
+template<class WriteArg>
+void moo::WriteLogFormat(std::ostream& aOut, std::string_view aFormat, size_t aArgCount, WriteArg&& aWriteArg)
+{
+    ForEachLogFormatPart(aFormat, aArgCount,
+        [&](std::string_view aText) { aOut << aText; },
+        [&](size_t aIndex) { aWriteArg(aOut, aIndex); });
+}
+
+template<class... Args>
+void moo::WriteLogFormat(std::ostream& aOut, std::string_view aFormat, const Args&... aArgs)
+{
+    WriteLogFormat(aOut, aFormat, sizeof...(Args), [&](std::ostream& aArgOut, size_t aIndex)
+        {
+            size_t index = 0;
+            ((index++ == aIndex ? static_cast<void>(aArgOut << aArgs) : static_cast<void>(0)), ...);
+        });
+}
+
+template<moo::LogFormattable T>
+void moo::AppendLogArg(std::string& aOut, const T& aValue)
+{
+    using namespace std;
+
+    if constexpr (is_same_v<T, bool>)
+    {
+        aOut += aValue ? "true" : "false";
+    }
+    else if constexpr (is_same_v<T, char>)
+    {
+        aOut += aValue;
+    }
+    else if constexpr (convertible_to<const T&, string_view>)
+    {
+        if constexpr (is_pointer_v<T>)
+        {
+            if (!aValue)
+            {
+                aOut += "(null)";
+                return;
+            }
+        }
+
+        aOut += string_view(aValue);
+    }
+    else if constexpr (is_enum_v<T>)
+    {
+        AppendLogArg(aOut, static_cast<underlying_type_t<T>>(aValue));
+    }
+    else if constexpr (is_pointer_v<T>)
+    {
+        char buffer[2 + 2 * sizeof(uintptr_t)] = { '0', 'x' };
+        const to_chars_result result = to_chars(buffer + 2, buffer + sizeof(buffer),
+            reinterpret_cast<uintptr_t>(aValue), 16);
+        aOut.append(buffer, result.ptr);
+    }
+    else
+    {
+        // Enough for any integer, and for the shortest form of any floating point value
+        char buffer[64];
+        const to_chars_result result = to_chars(buffer, buffer + sizeof(buffer), aValue);
+        aOut.append(buffer, result.ptr);
+    }
+}
+
+template<moo::LogFormattable... Args>
+void moo::AppendLogFormat(std::string& aOut, std::string_view aFormat, const Args&... aArgs)
+{
+    ForEachLogFormatPart(aFormat, sizeof...(Args),
+        [&](std::string_view aText) { aOut += aText; },
+        [&](size_t aIndex)
+        {
+            size_t index = 0;
+            ((index++ == aIndex ? AppendLogArg(aOut, aArgs) : static_cast<void>(0)), ...);
+        });
+}
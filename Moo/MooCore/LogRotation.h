@@ -0,0 +1,20 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace moo {
+    // When the log rolls over to a new file, and how many files are kept.
+    // A zero maxBytes or interval disables that trigger, and a zero keepFiles keeps every file.
+    struct LogRotation {
+        uint64_t maxBytes = 0;
+        std::chrono::seconds interval = std::chrono::seconds(0);
+        size_t keepFiles = 0;
+
+        [[nodiscard]] bool Enabled() const noexcept
+        {
+            return maxBytes > 0 || interval.count() > 0;
+        }
+    };
+}
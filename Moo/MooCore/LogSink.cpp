@@ -0,0 +1,155 @@
+#include "LogSink.h"
+
+#include "LogFile.h"
+
+#include <array>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+using namespace moo;
+
+FileSink::FileSink(LogFile& aFile) noexcept
+    : _file(aFile)
+{
+}
+
+void FileSink::Write(string_view aText, uint32_t)
+{
+    _file.Write(aText);
+}
+
+void FileSink::Flush()
+{
+    _file.Flush();
+}
+
+void FileSink::Sync()
+{
+    _file.Sync();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+#ifdef _WIN32
+
+void DebugOutputSink::Write(string_view aText, uint32_t)
+{
+    _buffer = aText;
+    OutputDebugStringA(_buffer.c_str());
+}
+
+#else
+
+FdSink::FdSink(int aFd, bool aClose) noexcept
+    : _fd(aFd)
+    , _close(aClose)
+{
+}
+
+FdSink::FdSink(const string& aPath, bool aAppend)
+    : _fd(open(aPath.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC | (aAppend ? O_APPEND : O_TRUNC), 0644))
+    , _close(true)
+{
+}
+
+FdSink::~FdSink()
+{
+    Flush();
+
+    if (_close && _fd >= 0)
+    {
+        close(_fd);
+    }
+}
+
+bool FdSink::is_open() const noexcept
+{
+    return _fd >= 0;
+}
+
+void FdSink::Write(string_view aText, uint32_t)
+{
+    if (_fd < 0 || aText.empty())
+    {
+        return;
+    }
+
+    _pending[_pendingCount++] = aText;
+    _pendingBytes += aText.size();
+
+    if (_pendingCount == cMaxPendingRecords || _pendingBytes >= cMaxPendingBytes)
+    {
+        Flush();
+    }
+}
+
+void FdSink::Flush()
+{
+    array<iovec, cMaxPendingRecords> iov;
+
+    for (size_t i = 0; i < _pendingCount; ++i)
+    {
+        // writev only reads it
+        iov[i].iov_base = const_cast<char*>(_pending[i].data());
+        iov[i].iov_len = _pending[i].size();
+    }
+
+    size_t first = 0;
+
+    while (first < _pendingCount)
+    {
+        const ssize_t written = writev(_fd, &iov[first], static_cast<int>(_pendingCount - first));
+
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            break; // there's nowhere left to report it
+        }
+
+        // Skip what was written, which can end in the middle of a record
+        size_t left = static_cast<size_t>(written);
+
+        while (first < _pendingCount && left >= iov[first].iov_len)
+        {
+            left -= iov[first].iov_len;
+            ++first;
+        }
+
+        if (first < _pendingCount)
+        {
+            iov[first].iov_base = static_cast<char*>(iov[first].iov_base) + left;
+            iov[first].iov_len -= left;
+        }
+    }
+
+    _pendingCount = 0;
+    _pendingBytes = 0;
+}
+
+void FdSink::Sync()
+{
+    if (_fd < 0)
+    {
+        return;
+    }
+
+#ifdef __linux__
+    fdatasync(_fd);
+#else
+    fsync(_fd);
+#endif
+}
+
+#endif
@@ -0,0 +1,83 @@
+#pragma once
+#include "MooDefaults.h"
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace moo {
+    class LogFile;
+
+    // Where the Logger writes its prefixed text.
+    // A sink is only called by one thread at a time: the one holding the Logger::Lock, or the writer thread
+    // in Async mode. The text stays valid until the sink's next Flush, so Write may keep the view instead of
+    // copying it. The Logger calls Flush as the LogFlushPolicy of the stream says, or when it needs the
+    // memory of the text back, and Sync after Flush when the policy is durable.
+    class LogSink {
+    public:
+        LogSink() = default;
+        virtual ~LogSink() = default;
+        MOO_DELETE_DEFAULTS(LogSink);
+
+        // aSiteId is the LogSite of a MOO_LOG record (see LogSite::Find), 0 for text written to a std stream
+        virtual void Write(std::string_view aText, uint32_t aSiteId) = 0;
+        virtual void Flush() {}
+        // Waits until what was flushed is on the disk, for sinks that have one
+        virtual void Sync() {}
+    };
+
+    // The Logger's LogFile
+    class FileSink : public LogSink {
+    public:
+        explicit FileSink(LogFile& aFile) noexcept;
+
+        void Write(std::string_view aText, uint32_t aSiteId) override;
+        void Flush() override;
+        void Sync() override;
+
+    private:
+        LogFile& _file;
+    };
+
+#ifdef _WIN32
+    // The debugger's output window
+    class DebugOutputSink : public LogSink {
+    public:
+        void Write(std::string_view aText, uint32_t aSiteId) override;
+
+    private:
+        std::string _buffer; // OutputDebugString needs a terminated string
+    };
+#else
+    // A file descriptor: standard output or error, or a file.
+    // The records written until the next Flush are gathered into a single writev call, or a few when there are
+    // a lot of them. It keeps the views of the records until then, without copying them.
+    // Like an ofstream, failing to open leaves it closed (is_open() is false), and failed writes are dropped.
+    class FdSink : public LogSink {
+    public:
+        // Closes aFd at the end only if aClose
+        explicit FdSink(int aFd, bool aClose = false) noexcept;
+        FdSink(const std::string& aPath, bool aAppend);
+        ~FdSink() override;
+
+        [[nodiscard]] bool is_open() const noexcept;
+
+        void Write(std::string_view aText, uint32_t aSiteId) override;
+        void Flush() override;
+        // Standard output and error usually can't be synced, which is ignored
+        void Sync() override;
+
+    private:
+        static constexpr size_t cMaxPendingRecords = 64;
+        static constexpr size_t cMaxPendingBytes = 64 * 1024;
+
+        int _fd = -1;
+        bool _close = false;
+
+        std::array<std::string_view, cMaxPendingRecords> _pending;
+        size_t _pendingCount = 0;
+        size_t _pendingBytes = 0;
+    };
+#endif
+}
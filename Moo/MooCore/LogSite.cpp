@@ -0,0 +1,275 @@
+#include "LogSite.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <mutex>
+#include <new>
+
+using namespace std;
+using namespace moo;
+
+namespace {
+    // The table of sites by id, in chunks that are allocated as the ids grow and never move or go away,
+    // so Find doesn't need a lock
+    constexpr size_t cChunkSize = 1024;
+    constexpr size_t cMaxChunks = 1024;
+
+    using Chunk = array<atomic<const LogSite*>, cChunkSize>;
+
+    array<atomic<Chunk*>, cMaxChunks> s_chunks;
+    atomic<uint32_t> s_lastId = 0;
+
+    atomic<LogLevel> s_minLevel = LogLevel::Trace;
+
+    // Read and written only together with the limits of all the sites
+    mutex s_defaultLimitsMutex;
+    LogSiteLimits s_defaultLimits;
+
+    // How often a message that keeps repeating is reported while it does
+    constexpr int64_t cRepeatReportIntervalNs = 1'000'000'000;
+
+    int64_t NowNs() noexcept
+    {
+        return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // FNV-1a, only compared with the last message of the same site
+    uint64_t Hash(string_view aMessage) noexcept
+    {
+        uint64_t hash = 14695981039346656037ull;
+
+        for (char c : aMessage)
+        {
+            hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+        }
+
+        return hash;
+    }
+
+    void Register(const LogSite& aSite) noexcept
+    {
+        const size_t chunkIndex = aSite.id / cChunkSize;
+
+        if (chunkIndex >= cMaxChunks)
+        {
+            return; // a million sites, can't be looked up anymore
+        }
+
+        Chunk* pChunk = s_chunks[chunkIndex].load(memory_order_acquire);
+
+        if (pChunk == nullptr)
+        {
+            Chunk* pNew = new (nothrow) Chunk{};
+
+            if (pNew == nullptr)
+            {
+                return;
+            }
+
+            if (s_chunks[chunkIndex].compare_exchange_strong(pChunk, pNew, memory_order_acq_rel))
+            {
+                pChunk = pNew;
+            }
+            else
+            {
+                delete pNew; // another site of the same chunk was first
+            }
+        }
+
+        (*pChunk)[aSite.id % cChunkSize].store(&aSite, memory_order_release);
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+LogSite::LogSite(Where aWhere, LogLevel aLevel, const char* aFormat) noexcept
+    : where(aWhere)
+    , level(aLevel)
+    , format(aFormat)
+    , id(++s_lastId)
+{
+    Register(*this);
+    Enabled(level >= s_minLevel.load(memory_order_relaxed));
+
+    scoped_lock lock(s_defaultLimitsMutex);
+    Limits(s_defaultLimits);
+}
+
+//static
+const LogSite* LogSite::Find(uint32_t aId) noexcept
+{
+    const size_t chunkIndex = aId / cChunkSize;
+
+    if (chunkIndex >= cMaxChunks)
+    {
+        return nullptr;
+    }
+
+    const Chunk* pChunk = s_chunks[chunkIndex].load(memory_order_acquire);
+    return pChunk ? (*pChunk)[aId % cChunkSize].load(memory_order_acquire) : nullptr;
+}
+
+//static
+uint32_t LogSite::LastId() noexcept
+{
+    return s_lastId.load(memory_order_relaxed);
+}
+
+//static
+void LogSite::ForEach(const function<void(const LogSite&)>& aFunction)
+{
+    const uint32_t lastId = LastId();
+
+    for (uint32_t id = 1; id <= lastId; ++id)
+    {
+        // Still missing while its constructor runs on another thread
+        if (const LogSite* pSite = Find(id))
+        {
+            aFunction(*pSite);
+        }
+    }
+}
+
+//static
+void LogSite::MinLevel(LogLevel aLevel) noexcept
+{
+    // Sites registered from now on read the new level, the older ones are switched here
+    s_minLevel.store(aLevel);
+
+    const uint32_t lastId = LastId();
+
+    for (uint32_t id = 1; id <= lastId; ++id)
+    {
+        if (const LogSite* pSite = Find(id))
+        {
+            pSite->Enabled(pSite->level >= aLevel);
+        }
+    }
+}
+
+//static
+LogLevel LogSite::MinLevel() noexcept
+{
+    return s_minLevel.load(memory_order_relaxed);
+}
+
+void LogSite::Limits(const LogSiteLimits& aLimits) const noexcept
+{
+    const uint32_t burst = max<uint32_t>(aLimits.burst, 1);
+    const int64_t interval = aLimits.perSecond > 0
+        ? max<int64_t>(1, static_cast<int64_t>(1e9 / aLimits.perSecond))
+        : 0;
+
+    _toleranceNs.store(interval * (burst - 1), memory_order_relaxed);
+    _dueNs.store(0, memory_order_relaxed);
+    _intervalNs.store(interval, memory_order_relaxed);
+    _collapseDuplicates.store(aLimits.collapseDuplicates, memory_order_relaxed);
+}
+
+LogSiteLimits LogSite::Limits() const noexcept
+{
+    const int64_t interval = _intervalNs.load(memory_order_relaxed);
+
+    LogSiteLimits limits;
+    limits.collapseDuplicates = _collapseDuplicates.load(memory_order_relaxed);
+
+    if (interval != 0)
+    {
+        limits.perSecond = 1e9 / static_cast<double>(interval);
+        limits.burst = static_cast<uint32_t>(_toleranceNs.load(memory_order_relaxed) / interval + 1);
+    }
+
+    return limits;
+}
+
+//static
+void LogSite::DefaultLimits(const LogSiteLimits& aLimits) noexcept
+{
+    scoped_lock lock(s_defaultLimitsMutex);
+    s_defaultLimits = aLimits;
+
+    // Sites registered from now on read the new limits, the older ones are reset here
+    const uint32_t lastId = LastId();
+
+    for (uint32_t id = 1; id <= lastId; ++id)
+    {
+        if (const LogSite* pSite = Find(id))
+        {
+            pSite->Limits(aLimits);
+        }
+    }
+}
+
+//static
+LogSiteLimits LogSite::DefaultLimits() noexcept
+{
+    scoped_lock lock(s_defaultLimitsMutex);
+    return s_defaultLimits;
+}
+
+uint64_t LogSite::TakeSuppressed() const noexcept
+{
+    return _suppressed.load(memory_order_relaxed) == 0 ? 0 : _suppressed.exchange(0, memory_order_relaxed);
+}
+
+bool LogSite::Repeated(string_view aMessage, uint64_t& aRepeats) const noexcept
+{
+    aRepeats = 0;
+
+    if (!_collapseDuplicates.load(memory_order_relaxed))
+    {
+        return false;
+    }
+
+    const uint64_t hash = Hash(aMessage);
+
+    // Between threads, "the last one" is whichever got here last
+    if (_lastHash.exchange(hash, memory_order_relaxed) == hash)
+    {
+        const int64_t now = NowNs();
+
+        if (_repeats.fetch_add(1, memory_order_relaxed) == 0)
+        {
+            _repeatsSinceNs.store(now, memory_order_relaxed);
+        }
+        else if (int64_t since = _repeatsSinceNs.load(memory_order_relaxed);
+            now - since >= cRepeatReportIntervalNs
+            && _repeatsSinceNs.compare_exchange_strong(since, now, memory_order_relaxed))
+        {
+            // Only one of the threads repeating it reports them
+            aRepeats = TakeRepeats();
+        }
+
+        return true;
+    }
+
+    aRepeats = TakeRepeats();
+    return false;
+}
+
+uint64_t LogSite::TakeRepeats() const noexcept
+{
+    return _repeats.load(memory_order_relaxed) == 0 ? 0 : _repeats.exchange(0, memory_order_relaxed);
+}
+
+// private:
+
+bool LogSite::TakeToken() const noexcept
+{
+    const int64_t interval = _intervalNs.load(memory_order_relaxed);
+    const int64_t tolerance = _toleranceNs.load(memory_order_relaxed);
+    const int64_t now = NowNs();
+    int64_t due = _dueNs.load(memory_order_relaxed);
+
+    do
+    {
+        if (now < due - tolerance)
+        {
+            _suppressed.fetch_add(1, memory_order_relaxed);
+            return false;
+        }
+    } while (!_dueNs.compare_exchange_weak(due, max(due, now) + interval, memory_order_relaxed));
+
+    return true;
+}
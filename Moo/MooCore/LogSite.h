@@ -0,0 +1,149 @@
+#pragma once
+#include "MooDefaults.h"
+#include "Where.h"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string_view>
+
+// Log statements below this LogLevel generate no code at all.
+// Defaults to Info in release builds and to Trace otherwise.
+#ifndef MOO_LOG_MIN_LEVEL
+#ifdef NDEBUG
+#define MOO_LOG_MIN_LEVEL Info
+#else
+#define MOO_LOG_MIN_LEVEL Trace
+#endif
+#endif
+
+// Registers the log statement it's used in, once, as s_mooLogSite. A_LEVEL is a LogLevel name, like Info.
+#define MOO_LOG_SITE(A_LEVEL, A_FORMAT) \
+    static const moo::LogSite s_mooLogSite(MOO_WHERE, moo::LogLevel::A_LEVEL, A_FORMAT)
+
+// Runs A_STATEMENT, which can use s_mooLogSite, only when the level passes MOO_LOG_MIN_LEVEL and A_CONDITION,
+// which can use it too, holds. Nothing in A_STATEMENT is evaluated otherwise.
+#define MOO_IF_LOG_SITE(A_LEVEL, A_FORMAT, A_CONDITION, A_STATEMENT) \
+    do \
+    { \
+        if constexpr (moo::LogLevel::A_LEVEL >= moo::cMinLogLevel) \
+        { \
+            MOO_LOG_SITE(A_LEVEL, A_FORMAT); \
+            if (A_CONDITION) \
+            { \
+                A_STATEMENT; \
+            } \
+        } \
+    } while (false)
+
+// MOO_IF_LOG_SITE when the switch of the site is on and its rate limit lets the statement through
+#define MOO_IF_LOG_SITE_ENABLED(A_LEVEL, A_FORMAT, A_STATEMENT) \
+    MOO_IF_LOG_SITE(A_LEVEL, A_FORMAT, s_mooLogSite.Enabled() && s_mooLogSite.Admit(), A_STATEMENT)
+
+namespace moo {
+    enum class LogLevel : uint8_t { Trace, Debug, Info, Warn, Error };
+
+    constexpr LogLevel cMinLogLevel = LogLevel::MOO_LOG_MIN_LEVEL;
+
+    [[nodiscard]] constexpr std::string_view ToString(LogLevel aLevel) noexcept
+    {
+        constexpr std::string_view names[] = { "trace", "debug", "info", "warn", "error" };
+        return names[static_cast<size_t>(aLevel)];
+    }
+
+    // What a site may write, see LogSite::Limits
+    struct LogSiteLimits {
+        // A token bucket: at most burst messages at once, refilled at perSecond. 0 perSecond is no limit.
+        double perSecond = 0;
+        uint32_t burst = 1;
+        // A message the same as the last one of the site isn't written again, the next different one
+        // is preceded by "last message repeated N times", which is also written once a second while the
+        // repeats go on
+        bool collapseDuplicates = false;
+    };
+
+    // A log statement in the code: where it is, its level and its format string.
+    // Each one is a function local static, created and registered the first time the statement runs, and gets
+    // a small id, which is all the records it produces need to carry. Whoever writes or decodes them later
+    // looks the rest up with Find.
+    // Ids start at 1 and are never reused; sites live until the end of the program.
+    //
+    // Every site has a switch, checked with a relaxed load before the arguments of a statement are evaluated.
+    // It starts on when the level is at least MinLevel, and setting MinLevel resets the switches of all the sites.
+    //
+    // The Limits of a site are checked the same way, with lock free counters, so a message over the rate costs
+    // a clock read and is counted instead of formatted. They start as DefaultLimits, and setting DefaultLimits
+    // resets the limits of all the sites. Logger::Write reports what was held back before the next message
+    // of the site that gets through, once a second while a message repeats, and when the Logger shuts down.
+    struct LogSite {
+        LogSite(Where aWhere, LogLevel aLevel, const char* aFormat) noexcept;
+        MOO_DELETE_DEFAULTS(LogSite);
+
+        [[nodiscard]] bool Enabled() const noexcept
+        {
+            return _enabled.load(std::memory_order_relaxed);
+        }
+
+        void Enabled(bool aEnabled) const noexcept
+        {
+            _enabled.store(aEnabled, std::memory_order_relaxed);
+        }
+
+        // nullptr if no site with that id has run yet
+        [[nodiscard]] static const LogSite* Find(uint32_t aId) noexcept;
+        // The highest id given out so far
+        [[nodiscard]] static uint32_t LastId() noexcept;
+        // Every site that has run so far, e.g. to switch sites by file
+        static void ForEach(const std::function<void(const LogSite&)>& aFunction);
+
+        static void MinLevel(LogLevel aLevel) noexcept;
+        [[nodiscard]] static LogLevel MinLevel() noexcept;
+
+        // False when the rate limit holds the message back, which is then counted as suppressed
+        [[nodiscard]] bool Admit() const noexcept
+        {
+            return _intervalNs.load(std::memory_order_relaxed) == 0 || TakeToken();
+        }
+
+        void Limits(const LogSiteLimits& aLimits) const noexcept;
+        [[nodiscard]] LogSiteLimits Limits() const noexcept;
+
+        static void DefaultLimits(const LogSiteLimits& aLimits) noexcept;
+        [[nodiscard]] static LogSiteLimits DefaultLimits() noexcept;
+
+        // The messages held back by the rate limit since the last call, which resets the count
+        [[nodiscard]] uint64_t TakeSuppressed() const noexcept;
+
+        // With collapseDuplicates, whether aMessage is the same as the last one the site wrote, which is then
+        // counted as a repeat. aRepeats gets the repeats of the previous message when it's a different one,
+        // and the repeats so far once a second while it's the same one.
+        [[nodiscard]] bool Repeated(std::string_view aMessage, uint64_t& aRepeats) const noexcept;
+        // The repeats of the last message so far, resetting the count
+        [[nodiscard]] uint64_t TakeRepeats() const noexcept;
+
+        const Where where;
+        const LogLevel level;
+        const char* const format;
+        const uint32_t id;
+
+        // The BinaryLogger file this site was last described in
+        mutable std::atomic<uint32_t> binaryLogFile = 0;
+
+    private:
+        bool TakeToken() const noexcept;
+
+        mutable std::atomic<bool> _enabled = false;
+
+        // The token bucket, as the time the next message is due (the generic cell rate algorithm):
+        // a message is let through unless it is more than _toleranceNs early
+        mutable std::atomic<int64_t> _intervalNs = 0; // 0 is no limit
+        mutable std::atomic<int64_t> _toleranceNs = 0;
+        mutable std::atomic<int64_t> _dueNs = 0;
+        mutable std::atomic<uint64_t> _suppressed = 0;
+
+        mutable std::atomic<bool> _collapseDuplicates = false;
+        mutable std::atomic<uint64_t> _lastHash = 0;
+        mutable std::atomic<uint64_t> _repeats = 0;
+        mutable std::atomic<int64_t> _repeatsSinceNs = 0; // when the repeats were last reported, or started
+    };
+}
@@ -1,13 +1,27 @@
 #include "Logger.h"
 
+#include "FlightRecorder.h"
+#include "LogFile.h"
+#include "LogSink.h"
+#include "LogSite.h"
+#include "MpmcRing.hpp"
 #include "RedirectStream.hpp"
+#include "RunningInstance.hpp"
+#include "StringUtils.hpp"
 #include "Time.hpp"
 
+#include <array>
+#include <atomic>
+#include <bit>
+#include <condition_variable>
 #include <mutex>
-#include <fstream>
 #include <set>
+#include <thread>
+#include <vector>
 
-#include <windows.h>
+#ifndef _WIN32
+#include <unistd.h>
+#endif
 
 using namespace std;
 using namespace moo;
@@ -16,62 +30,263 @@ namespace {
     constexpr bool cAssertSingleInstance = false;
     constexpr bool cTimeStampDate = false;
 
-    class Flusher {
+    constexpr chrono::seconds cDroppedReportInterval(1);
+    constexpr size_t cDroppedReportCheckRecords = 1024; // records written between checks while the queues are busy
+
+    using TimePoint = chrono::system_clock::time_point;
+
+    enum class Stream { Out, Log, Err };
+    constexpr size_t cStreams = 3;
+
+    Stream ToStream(const ostream& aOS) noexcept;
+
+    struct Record {
+        Stream _stream = Stream::Out;
+        TimePoint _time;
+        string _text; // from RecordBuffers::Make, the text comes after the room for the prefix
+        uint32_t _site = 0; // LogSite id, 0 for what was written to the stream
+        uint64_t _sequence = 0; // NextSequence when the record was complete
+    };
+
+    // The order of the records of all the streams, so the AsyncWriter can merge them
+    uint64_t NextSequence() noexcept;
+
+    // The text of the queued records, copied once by the producer into a buffer that has room for the prefix
+    // in front, so the writer thread can prefix a line in place. The buffers are reused once the sinks are done
+    // with them.
+    class RecordBuffers {
     public:
-        Flusher(ostream* pOS) noexcept;
-        void FlushLastIfNeeded();
+        static constexpr size_t cPrefixRoom = 48;
+
+        explicit RecordBuffers(size_t aCapacity);
+        MOO_DELETE_DEFAULTS(RecordBuffers);
+
+        // aNewLine adds a '\n' after aText
+        [[nodiscard]] string Make(string_view aText, bool aNewLine);
+        void Recycle(string&& aBuffer) noexcept;
+
     private:
-        ostream* _pOS;
+        // Larger ones are freed, so a few long records don't keep their memory
+        static constexpr size_t cMaxPooledBytes = 1024;
+
+        MpmcRing<string> _pool;
     };
 
+    // Copies the text into an output buffer, adding the prefix at the start of every line, in one pass.
+    // A line can be split between several records, so it remembers whether the last one ended a line.
+    // The output of several records accumulates until ClearOutput, since the sinks hold views of it. Before it
+    // would have to grow, which moves it, ReleaseOutput is called to make the sinks let go of them.
     class Prefixer {
     public:
         Prefixer(string aPrefix) noexcept;
-        void AddPrefix(string& aStr);
+        virtual ~Prefixer() = default;
+        MOO_DELETE_DEFAULTS(Prefixer);
+
+        // Returns the view of what aStr became, valid until ClearOutput. aNewLine adds a '\n' after aStr.
+        string_view AddPrefix(string_view aStr, TimePoint aTime, bool aNewLine);
     protected:
-        size_t PrefixSize() const noexcept;
-        string Prefix() const;
+        static constexpr size_t cOutputCapacity = 64 * 1024;
+
+        virtual void ReleaseOutput() = 0;
+        void ClearOutput() noexcept;
+        string_view Prefix(TimePoint aTime);
 
         string _prefix;
+        string _prefixBuffer; // time stamp + _prefix, reused so prefixing doesn't allocate
         bool _lastCharWasNewLine = true;
+    private:
+        void AddLines(string_view aStr, TimePoint aTime, string_view& aPrefix);
+        void Append(string_view aStr);
+
+        string _output;
+        size_t _recordStart = 0; // where the output of the record being prefixed starts
     };
 
-    class PreWriter : private Flusher, private Prefixer {
+    // All the sinks get the same prefixed text, so it's prefixed once, and they get a view of it.
+    // The text is copied once between the stream and the sinks: into the prefixed output in Sync mode, and into
+    // the queued record in Async mode, where a single line is prefixed in place.
+    class SinkLogger : private Prefixer {
     public:
-        PreWriter(ostream* pOS, string aPrefix = "") noexcept;
-        string PreWrite(string aStr);
+        SinkLogger(string aPrefix, vector<LogSink*> aSinks, const LogFlushPolicy& aFlushPolicy,
+            RecordBuffers* apRecordBuffers) noexcept;
+        ~SinkLogger() override;
+        MOO_DELETE_DEFAULTS(SinkLogger);
+
+        // aNewLine adds a '\n' after aStr, for the lines of MOO_LOG
+        void operator()(string_view aStr, TimePoint aTime, uint32_t aSiteId = 0, bool aNewLine = false);
+        // A queued record, whose buffer is kept until the sinks are flushed
+        void operator()(Record& aRecord);
+        // aIdle when there are no more records at hand, which is when an immediate policy flushes,
+        // unless the stream is in the middle of a line (e.g. between the insertions of a unit buffered cerr)
+        void FlushIfDue(bool aIdle);
+        void Flush();
+        // Whether something was written since the last flush, safe to call from any thread
+        [[nodiscard]] bool Unflushed() const noexcept;
+    private:
+        static constexpr size_t cMaxHeldRecords = 64;
+        static constexpr size_t cMaxHeldBytes = 64 * 1024;
+
+        void Write(string_view aPrefixed, uint32_t aSiteId);
+        // Flushes the sinks so they let go of the views of the output and the held records
+        void ReleaseOutput() override;
+        void RecycleHeld() noexcept;
+
+        vector<LogSink*> _sinks;
+        const LogFlushPolicy _flushPolicy;
+        RecordBuffers* _pRecordBuffers; // null in Sync mode
+        vector<string> _held; // the buffers of the queued records the sinks have views of
+        size_t _heldBytes = 0;
+        // Only written by the thread writing the records, and read by the FlushTimer
+        atomic<uint64_t> _unflushedBytes = 0;
+        chrono::steady_clock::time_point _lastFlush = chrono::steady_clock::now();
     };
 
-    class DebugLogger : private PreWriter {
+    // Calls aTick every aInterval until destroyed, for the flush policies with an interval
+    class FlushTimer {
     public:
-        DebugLogger(ostream* pOS, string aPrefix = "") noexcept;
-        void operator()(string aStr);
+        FlushTimer(chrono::milliseconds aInterval, function<void()> aTick);
+        ~FlushTimer();
+        MOO_DELETE_DEFAULTS(FlushTimer);
+    private:
+        void Run();
+
+        const chrono::milliseconds _interval;
+        function<void()> _tick;
+        mutex _mutex;
+        condition_variable _stopped;
+        bool _stop = false;
+        thread _thread;
     };
 
-    class FileLogger : private PreWriter {
+    // Owns the writer thread of the asynchronous mode.
+    // Each stream has its own ring and Logger::Overflow policy, so a full ring only holds back its own stream.
+    // Producers only copy their text into a record buffer (see RecordBuffers) and move the record into the ring
+    // of their stream. The writer thread pops them in the order
+    // of their sequence numbers, so the records of each thread keep their order across the streams, hands them
+    // to the processor, and calls aIdle each time all the rings run empty, or it's woken up with nothing to write.
+    // The destructor lets the writer thread drain what is left in the rings before joining it,
+    // and the last aIdle call gets aStopping.
+    class AsyncWriter {
     public:
-        FileLogger(ostream* pOS, ofstream& aFile, string aPrefix = "");
-        void operator()(string aStr);
+        using Processor = function<void(Record&)>;
+        using Idle = function<void(bool aStopping)>;
+        using Policies = array<Logger::Overflow, cStreams>;
+
+        AsyncWriter(size_t aCapacity, const Policies& aPolicies, size_t aSampleRate, RecordBuffers& aRecordBuffers,
+            Processor aProcessor, Idle aIdle);
+        ~AsyncWriter();
+        MOO_DELETE_DEFAULTS(AsyncWriter);
+
+        // aNewLine adds a '\n' after aText
+        void Push(Stream aStream, TimePoint aTime, string_view aText, bool aNewLine, uint32_t aSiteId);
+        void Wake() noexcept;
+
+        [[nodiscard]] uint64_t Dropped(Stream aStream) const noexcept;
+
     private:
-        ofstream& _file;
+        struct Queue {
+            Queue(size_t aCapacity, Logger::Overflow aPolicy);
+
+            MpmcRing<Record> _ring;
+            const Logger::Overflow _policy;
+            atomic<uint64_t> _overflows = 0; // pushes that found the ring full, for Sample
+            atomic<uint64_t> _dropped = 0;
+            uint64_t _reported = 0; // the part of _dropped already reported, only used by the writer thread
+        };
+
+        void Push(Record aRecord);
+        void Run();
+        // Pops the next record of every ring that has none in aHeads, see Run
+        void PopHeads(array<Record, cStreams>& aHeads, array<bool, cStreams>& aPopped);
+        void Wait();
+        [[nodiscard]] bool Empty() const noexcept;
+        void WaitForRoom(Queue& aQueue, Record& aRecord);
+        // Writes a "dropped" record to each stream that dropped some since the last one, if aNow or it's time
+        void ReportDropped(bool aNow);
+
+        array<unique_ptr<Queue>, cStreams> _queues;
+        const size_t _sampleRate;
+        RecordBuffers& _recordBuffers;
+        Processor _processor;
+        Idle _idle;
+        chrono::steady_clock::time_point _lastReport;
+        atomic<bool> _stop = false;
+        atomic<bool> _sleeping = false;
+        thread _thread;
     };
 
-    class DebugAndFileLogger {
+    // The RedirectStream target of each std stream.
+    // It does the producer side work (lock check, sequence number) and then either writes the record
+    // synchronously or queues it for the AsyncWriter.
+    // With thread local buffers the caller doesn't hold the Lock, so the synchronous write takes it here.
+    class StreamTarget {
     public:
-        DebugAndFileLogger(ostream* pOS, ofstream& aFile, string aPrefix = "");
-        void operator()(string aStr);
+        StreamTarget(Stream aStream, SinkLogger& aLogger, AsyncWriter* apAsyncWriter,
+            bool aThreadLocalBuffers) noexcept;
+        // A view of the stream's buffer: only the queued record copies it
+        void operator()(string_view aStr);
     private:
-        DebugLogger _debugLogger;
-        FileLogger _fileLogger;
+        Stream _stream;
+        SinkLogger& _logger;
+        AsyncWriter* _pAsyncWriter;
+        bool _threadLocalBuffers;
     };
 
     bool s_timeStamp = true;
     streamsize s_fractionSeconds = 4;
 
+    bool s_async = false;
+    size_t s_asyncQueueSize = 8192;
+
+    AsyncWriter::Policies s_overflowPolicies = {};
+    size_t s_overflowSampleRate = 100;
+
+    array<LogFlushPolicy, cStreams> s_flushPolicies = {
+        LogFlushPolicy{ 64 * 1024, chrono::milliseconds(100) },
+        LogFlushPolicy{ 64 * 1024, chrono::milliseconds(100) },
+        LogFlushPolicy{} };
+
+    bool s_threadLocalBuffers = false;
+
+    bool s_mappedLogFile = false;
+    uint64_t s_mappedLogFileSyncBytes = 0;
+
+    LogRotation s_rotation;
+
+    vector<shared_ptr<LogSink>> s_sinks;
+
     size_t s_lockCount = 0;
     bool s_assertLock = true;
 
     void AssertLock() noexcept;
+
+    // Read on every Lock, and it can change while threads log
+    atomic<bool> s_lockStats = false;
+
+    // LatencyHistogram written by one thread and read by Stats on any other
+    class AtomicHistogram {
+    public:
+        void Add(chrono::steady_clock::duration aDuration) noexcept;
+        [[nodiscard]] LatencyHistogram Load() const noexcept;
+    private:
+        array<atomic<uint64_t>, LatencyHistogram::cBuckets> _counts = {};
+        atomic<uint64_t> _totalNs = 0;
+    };
+
+    // The LoggerThreadStats of one thread. Registered the first time the thread records something,
+    // and kept after the thread ends.
+    struct ThreadStatsRecorder {
+        thread::id _thread = this_thread::get_id();
+        atomic<uint64_t> _acquisitions = 0;
+        AtomicHistogram _lockWait;
+        AtomicHistogram _lockHold;
+        AtomicHistogram _queueWait;
+
+        static ThreadStatsRecorder& Local();
+    };
+
+    mutex s_threadStatsMutex;
+    vector<shared_ptr<ThreadStatsRecorder>> s_threadStats;
 }
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -79,13 +294,48 @@ namespace {
 struct Logger::Instance {
     Instance(const string& aLogPath);
 
-    ofstream _file;
+    LogFile _file;
+
+    // Declared before the loggers that write to them
+    unique_ptr<LogSink> _pDebugSink;
+    FileSink _fileSink;
+    vector<shared_ptr<LogSink>> _sinks; // Logger::Sinks when it started
+
+    // Async mode only, declared before the loggers that hold some of the buffers
+    unique_ptr<RecordBuffers> _pRecordBuffers;
+
+    SinkLogger _coutLogger;
+    SinkLogger _clogLogger;
+    SinkLogger _cerrLogger;
 
-    RedirectStream<DebugLogger> _coutRedirectStream;
-    RedirectStream<DebugAndFileLogger> _clogRedirectStream;
-    RedirectStream<DebugAndFileLogger> _cerrRedirectStream;
+    // Declared after the loggers and before the streams, so it is drained after the streams are restored
+    // and before the loggers are gone
+    unique_ptr<AsyncWriter> _asyncWriter;
+    // Stopped before the writer and the loggers it flushes
+    unique_ptr<FlushTimer> _flushTimer;
+
+    RedirectStream<StreamTarget> _coutRedirectStream;
+    RedirectStream<StreamTarget> _clogRedirectStream;
+    RedirectStream<StreamTarget> _cerrRedirectStream;
+
+    void Write(const LogSite& aSite, string_view aMessage);
+    // A whole line without its '\n'
+    void Write(Stream aStream, TimePoint aTime, string_view aLine, uint32_t aSiteId);
+    // Hands cout, clog and cerr back to their own buffers
+    void RestoreStreams() noexcept;
+    void Process(Record& aRecord, bool aIdle);
+    void FlushIfDue(bool aIdle);
+    void Flush();
+    [[nodiscard]] bool Unflushed() const noexcept;
+    SinkLogger& LoggerOf(Stream aStream) noexcept;
+
+    // What clog and cerr go to, cout only goes to the debug sink
+    vector<LogSink*> FileSinks();
 
     static inline weak_ptr<Instance> s_instance;
+    // The same instance, for Logger::Write, which can't afford locking s_instanceMutex.
+    // ~Logger waits for the threads still writing through it before destroying it.
+    static inline RunningInstance<Instance> s_running;
     static inline mutex s_instanceMutex;
 
     static inline string s_defaultLogPath = "Moo.log";
@@ -97,15 +347,140 @@ struct Logger::Instance {
     template<class T, class... Args>
     static RedirectStream<T> CreateRedirect(ostream& aOS, Args&&... aArgs);
 
-    static ios::_Openmode Openmode(const string& aLogPath);
+    // A whole line of a site, through the running instance or to clog or cerr
+    static void WriteLine(const LogSite& aSite, string_view aMessage);
+    // What the limits of the site held back (see LogSiteLimits), aRepeats being the repeats of its last message
+    static void WriteHeldBack(const LogSite& aSite, uint64_t aRepeats);
+
+    static bool Append(const string& aLogPath);
+    static LogFileOptions FileOptions() noexcept;
+    static unique_ptr<LogSink> CreateDebugSink();
+    // The shortest interval of the flush policies, 0 when none has one
+    static chrono::milliseconds FlushInterval() noexcept;
 };
 
 Logger::Instance::Instance(const string& aLogPath)
-    : _file(aLogPath, Openmode(aLogPath))
-    , _coutRedirectStream(CreateRedirect<DebugLogger>(cout, " out | "))
-    , _clogRedirectStream(CreateRedirect<DebugAndFileLogger>(clog, _file, " log | "))
-    , _cerrRedirectStream(CreateRedirect<DebugAndFileLogger>(cerr, _file, "-ERR-| "))
+    : _file(aLogPath, Append(aLogPath), FileOptions())
+    , _pDebugSink(CreateDebugSink())
+    , _fileSink(_file)
+    , _sinks(s_sinks)
+    , _pRecordBuffers(s_async ? make_unique<RecordBuffers>(s_asyncQueueSize) : nullptr)
+    , _coutLogger(" out | ", { _pDebugSink.get() }, s_flushPolicies[static_cast<size_t>(Stream::Out)],
+        _pRecordBuffers.get())
+    , _clogLogger(" log | ", FileSinks(), s_flushPolicies[static_cast<size_t>(Stream::Log)], _pRecordBuffers.get())
+    , _cerrLogger("-ERR-| ", FileSinks(), s_flushPolicies[static_cast<size_t>(Stream::Err)], _pRecordBuffers.get())
+    , _asyncWriter(s_async ? make_unique<AsyncWriter>(s_asyncQueueSize, s_overflowPolicies, s_overflowSampleRate,
+                                 *_pRecordBuffers,
+                                 [this](Record& aRecord) { Process(aRecord, false); },
+                                 [this](bool aStopping) { aStopping ? Flush() : FlushIfDue(true); })
+                           : nullptr)
+    , _flushTimer(FlushInterval().count() == 0 ? nullptr : make_unique<FlushTimer>(FlushInterval(), [this]()
+        {
+            // Most ticks find nothing to flush, and they shouldn't take the Lock for that
+            if (!Unflushed())
+            {
+                return;
+            }
+
+            if (_asyncWriter)
+            {
+                // The sinks belong to the writer thread
+                _asyncWriter->Wake();
+                return;
+            }
+
+            Logger::Lock lock;
+            FlushIfDue(false);
+        }))
+    , _coutRedirectStream(CreateRedirect<StreamTarget>(
+        cout, Stream::Out, _coutLogger, _asyncWriter.get(), s_threadLocalBuffers))
+    , _clogRedirectStream(CreateRedirect<StreamTarget>(
+        clog, Stream::Log, _clogLogger, _asyncWriter.get(), s_threadLocalBuffers))
+    , _cerrRedirectStream(CreateRedirect<StreamTarget>(
+        cerr, Stream::Err, _cerrLogger, _asyncWriter.get(), s_threadLocalBuffers))
+{
+    _coutRedirectStream.ThreadLocalBuffers(s_threadLocalBuffers);
+    _clogRedirectStream.ThreadLocalBuffers(s_threadLocalBuffers);
+    _cerrRedirectStream.ThreadLocalBuffers(s_threadLocalBuffers);
+}
+
+void Logger::Instance::Write(const LogSite& aSite, string_view aMessage)
+{
+    const Stream stream = aSite.level == LogLevel::Error ? Stream::Err : Stream::Log;
+    Write(stream, chrono::system_clock::now(), aMessage, aSite.id);
+}
+
+void Logger::Instance::Write(Stream aStream, TimePoint aTime, string_view aLine, uint32_t aSiteId)
+{
+    if (_asyncWriter)
+    {
+        _asyncWriter->Push(aStream, aTime, aLine, true, aSiteId);
+    }
+    else
+    {
+        Logger::Lock lock;
+        SinkLogger& logger = LoggerOf(aStream);
+        logger(aLine, aTime, aSiteId, true);
+        logger.FlushIfDue(true);
+    }
+}
+
+void Logger::Instance::RestoreStreams() noexcept
 {
+    _coutRedirectStream.Restore();
+    _clogRedirectStream.Restore();
+    _cerrRedirectStream.Restore();
+}
+
+void Logger::Instance::Process(Record& aRecord, bool aIdle)
+{
+    SinkLogger& logger = LoggerOf(aRecord._stream);
+    logger(aRecord);
+    logger.FlushIfDue(aIdle);
+}
+
+void Logger::Instance::FlushIfDue(bool aIdle)
+{
+    _coutLogger.FlushIfDue(aIdle);
+    _clogLogger.FlushIfDue(aIdle);
+    _cerrLogger.FlushIfDue(aIdle);
+}
+
+void Logger::Instance::Flush()
+{
+    _coutLogger.Flush();
+    _clogLogger.Flush();
+    _cerrLogger.Flush();
+}
+
+bool Logger::Instance::Unflushed() const noexcept
+{
+    return _coutLogger.Unflushed() || _clogLogger.Unflushed() || _cerrLogger.Unflushed();
+}
+
+SinkLogger& Logger::Instance::LoggerOf(Stream aStream) noexcept
+{
+    switch (aStream)
+    {
+    case Stream::Out:
+        return _coutLogger;
+    case Stream::Err:
+        return _cerrLogger;
+    default:
+        return _clogLogger;
+    }
+}
+
+vector<LogSink*> Logger::Instance::FileSinks()
+{
+    vector<LogSink*> sinks = { _pDebugSink.get(), &_fileSink };
+
+    for (const shared_ptr<LogSink>& pSink : _sinks)
+    {
+        sinks.push_back(pSink.get());
+    }
+
+    return sinks;
 }
 
 Logger::Logger(const string& aLogPath) noexcept
@@ -121,10 +496,13 @@ Logger::Logger(const string& aLogPath) noexcept
 
             if (Instance::s_instance.expired())
             {
+                // MOO_LOG writes to clog and cerr under the Lock while no Logger runs, see ~Logger
+                Lock logLock;
+
                 _instance = make_shared<Instance>(aLogPath != "" ? aLogPath : Instance::s_defaultLogPath);
                 Instance::s_instance = _instance;
+                Instance::s_running.Start(_instance.get());
 
-                Lock logLock;
                 clog << "moo::Logger started" << endl;
             }
         },
@@ -139,10 +517,29 @@ Logger::~Logger()
 
             if (_instance.use_count() == 1)
             {
+                {
+                    Lock logLock;
+
+                    LogSite::ForEach(
+                        [](const LogSite& aSite) { Instance::WriteHeldBack(aSite, aSite.TakeRepeats()); });
+
+                    clog << "moo::Logger shutting down" << endl;
+                    // Warning:
+                    // If this line is removed, then maybe a flush will be needed in case something is left in a stream
+
+                    if (!_instance->_asyncWriter)
+                    {
+                        // The writer thread does it when it stops
+                        _instance->Flush();
+                    }
+                }
+
+                // Outside the Lock, which a synchronous write still in progress may be waiting for
+                Instance::s_running.Stop(_instance.get());
+
+                // From now on MOO_LOG writes to clog and cerr, under the Lock
                 Lock logLock;
-                clog << "moo::Logger shutting down" << endl;
-                // Warning:
-                // If this line is removed, then maybe a flush will be needed in case something is left in a stream
+                _instance->RestoreStreams();
             }
 
             _instance.reset();
@@ -150,21 +547,95 @@ Logger::~Logger()
         MOO_WHERE);
 }
 
+//static
+void Logger::Instance::WriteLine(const LogSite& aSite, string_view aMessage)
+{
+    if (RunningInstance<Instance>::Use pInstance(s_running); pInstance)
+    {
+        pInstance->Write(aSite, aMessage);
+        return;
+    }
+
+    Logger::Lock lock;
+    ostream& os = aSite.level == LogLevel::Error ? cerr : clog;
+    os << aMessage << endl;
+}
+
+//static
+void Logger::Instance::WriteHeldBack(const LogSite& aSite, uint64_t aRepeats)
+{
+    if (aRepeats != 0)
+    {
+        WriteLine(aSite, "last message repeated " + to_string(aRepeats) + " times");
+    }
+
+    if (const uint64_t suppressed = aSite.TakeSuppressed(); suppressed != 0)
+    {
+        WriteLine(aSite, to_string(suppressed) + " messages suppressed by the rate limit");
+    }
+}
+
 template<class T, class... Args>
 RedirectStream<T> Logger::Instance::CreateRedirect(ostream& aOS, Args&&... aArgs)
 {
-    return RedirectStream<T>(&aOS, &aOS, forward<Args>(aArgs)...);
+    return RedirectStream<T>(&aOS, forward<Args>(aArgs)...);
 }
 
-ios::_Openmode Logger::Instance::Openmode(const string& aLogPath)
+bool Logger::Instance::Append(const string& aLogPath)
 {
     const bool inserted = s_openedLogPaths.insert(aLogPath).second;
-    return inserted ? ios::trunc : ios::app;
+    return !inserted;
+}
+
+LogFileOptions Logger::Instance::FileOptions() noexcept
+{
+    return { s_mappedLogFile, s_mappedLogFileSyncBytes, s_rotation };
+}
+
+chrono::milliseconds Logger::Instance::FlushInterval() noexcept
+{
+    chrono::milliseconds interval(0);
+
+    for (const LogFlushPolicy& policy : s_flushPolicies)
+    {
+        if (policy.interval.count() > 0 && (interval.count() == 0 || policy.interval < interval))
+        {
+            interval = policy.interval;
+        }
+    }
+
+    return interval;
+}
+
+unique_ptr<LogSink> Logger::Instance::CreateDebugSink()
+{
+#ifdef _WIN32
+    return make_unique<DebugOutputSink>();
+#else
+    // No debugger window to write to. It's the descriptor, so it's not redirected like cerr.
+    return make_unique<FdSink>(STDERR_FILENO);
+#endif
 }
 
 MOO_SUPPRESS(26115) // Failing to release lock
 Logger::Lock::Lock() noexcept
-    : _lock(NoExcept([&]() { return unique_lock(Instance::s_logMutex); }, MOO_WHERE))
+    : _lock(NoExcept([&]()
+        {
+            if (!s_lockStats.load(memory_order_relaxed))
+            {
+                return unique_lock(Instance::s_logMutex);
+            }
+
+            const auto start = chrono::steady_clock::now();
+            unique_lock lock(Instance::s_logMutex);
+            _acquiredAt = chrono::steady_clock::now();
+
+            ThreadStatsRecorder& stats = ThreadStatsRecorder::Local();
+            stats._acquisitions.store(stats._acquisitions.load(memory_order_relaxed) + 1, memory_order_relaxed);
+            stats._lockWait.Add(_acquiredAt - start);
+            return lock;
+        },
+        MOO_WHERE))
 {
     if (_lock.owns_lock())
     {
@@ -177,176 +648,789 @@ Logger::Lock::~Lock()
     if (_lock.owns_lock())
     {
         --s_lockCount;
+
+        if (_acquiredAt != chrono::steady_clock::time_point())
+        {
+            NoExcept([&]() { ThreadStatsRecorder::Local()._lockHold.Add(chrono::steady_clock::now() - _acquiredAt); },
+                MOO_WHERE);
+        }
     }
 }
 
+
 //----------------------------------------------------------------------------------------------------------------------
 
-Flusher::Flusher(ostream* pOS) noexcept
-    : _pOS(pOS)
+Prefixer::Prefixer(string aPrefix) noexcept
+    : _prefix(move(aPrefix))
 {
 }
 
-void Flusher::FlushLastIfNeeded()
+string_view Prefixer::Prefix(TimePoint aTime)
 {
-    static ostream* s_pLastOS = nullptr;
-    static bool s_flushingLast = false;
-
-    if (s_flushingLast)
+    if (!s_timeStamp)
     {
-        return;
+        return _prefix;
     }
 
-    if (s_pLastOS && s_pLastOS != _pOS)
+    _prefixBuffer = TimeStampFormatter::Format(aTime, s_fractionSeconds, cTimeStampDate);
+    _prefixBuffer += _prefix;
+    return _prefixBuffer;
+}
+
+string_view Prefixer::AddPrefix(string_view aStr, TimePoint aTime, bool aNewLine)
+{
+    _recordStart = _output.size();
+
+    // All the lines of a record have the same time, so the prefix is formatted once, when the first line starts
+    string_view prefix;
+    AddLines(aStr, aTime, prefix);
+
+    if (aNewLine)
     {
-        s_flushingLast = true;
-        s_pLastOS->flush();
-        s_flushingLast = false;
+        AddLines("\n", aTime, prefix);
     }
 
-    s_pLastOS = _pOS;
+    return string_view(_output).substr(_recordStart);
+}
+
+void Prefixer::ClearOutput() noexcept
+{
+    _output.clear();
+    _recordStart = 0;
 }
 
 //----------------------------------------------------------------------------------------------------------------------
+// private:
 
-Prefixer::Prefixer(string aPrefix) noexcept
-    : _prefix(move(aPrefix))
+void Prefixer::AddLines(string_view aStr, TimePoint aTime, string_view& aPrefix)
 {
+    const char* pLine = aStr.data();
+    const char* pEnd = pLine + aStr.size();
+
+    while (pLine != pEnd)
+    {
+        if (_lastCharWasNewLine)
+        {
+            if (aPrefix.empty())
+            {
+                aPrefix = Prefix(aTime);
+            }
+
+            Append(aPrefix);
+        }
+
+        const char* pNewLine = FindChar(pLine, pEnd, '\n');
+        const char* pLineEnd = pNewLine == pEnd ? pEnd : pNewLine + 1;
+
+        Append({ pLine, pLineEnd });
+        _lastCharWasNewLine = pNewLine != pEnd;
+        pLine = pLineEnd;
+    }
 }
 
-size_t Prefixer::PrefixSize() const noexcept
+void Prefixer::Append(string_view aStr)
 {
-    if (!s_timeStamp)
+    if (_output.size() + aStr.size() > _output.capacity())
     {
-        return _prefix.size();
+        // Growing moves the output, so the sinks first let go of the records before this one
+        if (_recordStart != 0)
+        {
+            ReleaseOutput();
+            _output.erase(0, _recordStart);
+            _recordStart = 0;
+        }
+
+        _output.reserve(max(_output.size() + aStr.size(), cOutputCapacity));
     }
 
-    return _prefix.size() + TimeStampSize(s_fractionSeconds, cTimeStampDate) + s_fractionSeconds;
+    _output += aStr;
 }
 
-string Prefixer::Prefix() const
+//----------------------------------------------------------------------------------------------------------------------
+
+SinkLogger::SinkLogger(string aPrefix, vector<LogSink*> aSinks, const LogFlushPolicy& aFlushPolicy,
+    RecordBuffers* apRecordBuffers) noexcept
+    : Prefixer(move(aPrefix))
+    , _sinks(move(aSinks))
+    , _flushPolicy(aFlushPolicy)
+    , _pRecordBuffers(apRecordBuffers)
 {
-    if (!s_timeStamp)
+}
+
+SinkLogger::~SinkLogger()
+{
+    // The sinks outlive us, and they may still have views of our text
+    NoExcept([&]() { ReleaseOutput(); }, MOO_WHERE);
+}
+
+void SinkLogger::operator()(string_view aStr, TimePoint aTime, uint32_t aSiteId, bool aNewLine)
+{
+    Write(AddPrefix(aStr, aTime, aNewLine), aSiteId);
+}
+
+void SinkLogger::operator()(Record& aRecord)
+{
+    string& buffer = aRecord._text;
+    const string_view text = string_view(buffer).substr(RecordBuffers::cPrefixRoom);
+    const char* pNewLine = FindChar(text.data(), text.data() + text.size(), '\n');
+
+    // A record of a single line, or of the rest of one, is prefixed in the room in front of its text
+    if (pNewLine >= text.data() + text.size() - 1)
     {
-        return _prefix;
+        const string_view prefix = _lastCharWasNewLine ? Prefix(aRecord._time) : string_view();
+
+        if (prefix.size() <= RecordBuffers::cPrefixRoom)
+        {
+            const size_t start = RecordBuffers::cPrefixRoom - prefix.size();
+            prefix.copy(buffer.data() + start, prefix.size());
+            _lastCharWasNewLine = text.ends_with('\n');
+
+            if (_held.size() == cMaxHeldRecords || _heldBytes + buffer.size() > cMaxHeldBytes)
+            {
+                ReleaseOutput();
+            }
+
+            Write(string_view(buffer).substr(start), aRecord._site);
+
+            // The buffer is longer than any small string, so moving it keeps the text where the sinks see it
+            _heldBytes += buffer.size();
+            _held.push_back(move(buffer));
+            return;
+        }
     }
 
-    return TimeStampString(s_fractionSeconds, cTimeStampDate) + _prefix;
+    (*this)(text, aRecord._time, aRecord._site);
+    _pRecordBuffers->Recycle(move(buffer));
 }
 
-void Prefixer::AddPrefix(string& aStr)
+void SinkLogger::FlushIfDue(bool aIdle)
 {
-    if (aStr.size() == 0)
+    const uint64_t unflushedBytes = _unflushedBytes.load(memory_order_relaxed);
+
+    if (unflushedBytes == 0)
     {
         return;
     }
 
-    if (_lastCharWasNewLine)
+    if (_flushPolicy.Immediate())
     {
-        aStr.insert(0, Prefix());
+        if (aIdle && _lastCharWasNewLine)
+        {
+            Flush();
+        }
+
+        return;
     }
 
-    for (size_t i = 0; i < aStr.size(); i += PrefixSize() + 1)
+    if ((_flushPolicy.bytes > 0 && unflushedBytes >= _flushPolicy.bytes)
+        || (_flushPolicy.interval.count() > 0 && chrono::steady_clock::now() - _lastFlush >= _flushPolicy.interval))
     {
-        i = aStr.find("\n", i);
+        Flush();
+    }
+}
 
-        if (i >= aStr.size())
-        {
-            break;
-        }
+void SinkLogger::Flush()
+{
+    for (LogSink* pSink : _sinks)
+    {
+        pSink->Flush();
+    }
 
-        if (i == aStr.size() - 1)
+    ClearOutput();
+    RecycleHeld();
+
+    if (_flushPolicy.durable)
+    {
+        for (LogSink* pSink : _sinks)
         {
-            _lastCharWasNewLine = true;
-            return;
+            pSink->Sync();
         }
-
-        aStr.insert(i + 1, Prefix());
     }
 
-    _lastCharWasNewLine = false;
+    _unflushedBytes.store(0, memory_order_relaxed);
+    _lastFlush = chrono::steady_clock::now();
+}
+
+bool SinkLogger::Unflushed() const noexcept
+{
+    return _unflushedBytes.load(memory_order_relaxed) != 0;
 }
 
 //----------------------------------------------------------------------------------------------------------------------
+// private:
+
+void SinkLogger::Write(string_view aPrefixed, uint32_t aSiteId)
+{
+    for (LogSink* pSink : _sinks)
+    {
+        pSink->Write(aPrefixed, aSiteId);
+    }
+
+    _unflushedBytes.store(_unflushedBytes.load(memory_order_relaxed) + aPrefixed.size(), memory_order_relaxed);
+}
 
-PreWriter::PreWriter(ostream* pOS, string aPrefix) noexcept
-    : Flusher(pOS)
-    , Prefixer(move(aPrefix))
+void SinkLogger::ReleaseOutput()
 {
+    // It doesn't count as a flush of the policy, so it's neither synced nor does it restart the interval
+    for (LogSink* pSink : _sinks)
+    {
+        pSink->Flush();
+    }
+
+    RecycleHeld();
 }
 
-string PreWriter::PreWrite(string aStr)
+void SinkLogger::RecycleHeld() noexcept
 {
-    AssertLock();
-    FlushLastIfNeeded();
-    AddPrefix(aStr);
-    return aStr;
+    for (string& buffer : _held)
+    {
+        _pRecordBuffers->Recycle(move(buffer));
+    }
+
+    _held.clear();
+    _heldBytes = 0;
 }
 
 //----------------------------------------------------------------------------------------------------------------------
 
-DebugLogger::DebugLogger(ostream* pOS, string aPrefix) noexcept
-    : PreWriter(pOS, move(aPrefix))
+RecordBuffers::RecordBuffers(size_t aCapacity)
+    : _pool(aCapacity)
 {
 }
 
-void DebugLogger::operator()(string aStr)
+string RecordBuffers::Make(string_view aText, bool aNewLine)
 {
-    aStr = PreWrite(aStr);
-    OutputDebugString(aStr.c_str());
-}
+    string buffer;
 
-//----------------------------------------------------------------------------------------------------------------------
+    if (!_pool.TryPop(buffer))
+    {
+        buffer.reserve(cPrefixRoom + aText.size() + 1);
+    }
 
-FileLogger::FileLogger(ostream* pOS, ofstream& aFile, string aPrefix)
-    : PreWriter(pOS, move(aPrefix))
-    , _file(aFile)
-{
+    buffer.assign(cPrefixRoom, ' ');
+    buffer += aText;
+
+    if (aNewLine)
+    {
+        buffer += '\n';
+    }
+
+    return buffer;
 }
 
-void FileLogger::operator()(string aStr)
+void RecordBuffers::Recycle(string&& aBuffer) noexcept
 {
-    aStr = PreWrite(aStr);
-    _file << aStr.c_str();
+    if (aBuffer.capacity() <= cMaxPooledBytes)
+    {
+        // Freed when the pool is full
+        (void)_pool.TryPush(move(aBuffer));
+    }
 }
 
 //----------------------------------------------------------------------------------------------------------------------
 
-DebugAndFileLogger::DebugAndFileLogger(ostream* pOS, ofstream& aFile, string aPrefix)
-    : _debugLogger(pOS, aPrefix)
-    , _fileLogger(pOS, aFile, move(aPrefix)) {}
-
-void DebugAndFileLogger::operator()(string aStr)
+FlushTimer::FlushTimer(chrono::milliseconds aInterval, function<void()> aTick)
+    : _interval(aInterval)
+    , _tick(move(aTick))
+    , _thread([this]() { Run(); })
 {
-    _debugLogger(aStr);
-    _fileLogger(move(aStr));
 }
 
-//----------------------------------------------------------------------------------------------------------------------
+FlushTimer::~FlushTimer()
+{
+    NoExcept([&]()
+        {
+            {
+                scoped_lock lock(_mutex);
+                _stop = true;
+            }
+
+            _stopped.notify_one();
+            _thread.join();
+        },
+        MOO_WHERE);
+}
 
-void ::AssertLock() noexcept
+void FlushTimer::Run()
 {
-    if (s_assertLock)
+    unique_lock lock(_mutex);
+
+    while (!_stopped.wait_for(lock, _interval, [this]() { return _stop; }))
     {
-        MOO_ASSERT(s_lockCount > 0);
+        lock.unlock();
+        NoExcept([&]() { _tick(); }, MOO_WHERE);
+        lock.lock();
     }
 }
 
 //----------------------------------------------------------------------------------------------------------------------
 
-//static
-void Logger::DefaultLogPath(string aLogPath) noexcept
+AsyncWriter::AsyncWriter(size_t aCapacity, const Policies& aPolicies, size_t aSampleRate,
+    RecordBuffers& aRecordBuffers, Processor aProcessor, Idle aIdle)
+    : _queues{ make_unique<Queue>(aCapacity, aPolicies[0]), make_unique<Queue>(aCapacity, aPolicies[1]),
+        make_unique<Queue>(aCapacity, aPolicies[2]) }
+    , _sampleRate(max<size_t>(aSampleRate, 1))
+    , _recordBuffers(aRecordBuffers)
+    , _processor(move(aProcessor))
+    , _idle(move(aIdle))
+    , _lastReport(chrono::steady_clock::now())
+    , _thread([this]() { Run(); })
 {
-    Instance::s_defaultLogPath = move(aLogPath);
-}
-//static
-const string& Logger::DefaultLogPath() noexcept
-{
-    return Instance::s_defaultLogPath;
 }
 
-//static
-void Logger::AssertLock(bool aAssert) noexcept
+AsyncWriter::~AsyncWriter()
+{
+    NoExcept([&]()
+        {
+            _stop = true;
+            _sleeping = false;
+            _sleeping.notify_one();
+            _thread.join();
+        },
+        MOO_WHERE);
+}
+
+void AsyncWriter::Push(Stream aStream, TimePoint aTime, string_view aText, bool aNewLine, uint32_t aSiteId)
+{
+    Push({ aStream, aTime, _recordBuffers.Make(aText, aNewLine), aSiteId, NextSequence() });
+}
+
+void AsyncWriter::Wake() noexcept
+{
+    if (_sleeping.load() && _sleeping.exchange(false))
+    {
+        _sleeping.notify_one();
+    }
+}
+
+uint64_t AsyncWriter::Dropped(Stream aStream) const noexcept
+{
+    return _queues[static_cast<size_t>(aStream)]->_dropped.load(memory_order_relaxed);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// private:
+
+AsyncWriter::Queue::Queue(size_t aCapacity, Logger::Overflow aPolicy)
+    : _ring(aCapacity)
+    , _policy(aPolicy)
+{
+}
+
+void AsyncWriter::Push(Record aRecord)
+{
+    Queue& queue = *_queues[static_cast<size_t>(aRecord._stream)];
+
+    if (!queue._ring.TryPush(move(aRecord)))
+    {
+        switch (queue._policy)
+        {
+        case Logger::Overflow::Block:
+            WaitForRoom(queue, aRecord);
+            break;
+        case Logger::Overflow::DropNewest:
+            queue._dropped.fetch_add(1, memory_order_relaxed);
+            _recordBuffers.Recycle(move(aRecord._text));
+            return;
+        case Logger::Overflow::DropOldest:
+            {
+                Record oldest;
+
+                do
+                {
+                    if (queue._ring.TryPop(oldest))
+                    {
+                        queue._dropped.fetch_add(1, memory_order_relaxed);
+                        _recordBuffers.Recycle(move(oldest._text));
+                    }
+                } while (!queue._ring.TryPush(move(aRecord)));
+            }
+            break;
+        case Logger::Overflow::Sample:
+            if (queue._overflows.fetch_add(1, memory_order_relaxed) % _sampleRate != 0)
+            {
+                queue._dropped.fetch_add(1, memory_order_relaxed);
+                _recordBuffers.Recycle(move(aRecord._text));
+                return;
+            }
+
+            WaitForRoom(queue, aRecord);
+            break;
+        }
+    }
+
+    Wake();
+}
+
+void AsyncWriter::Run()
+{
+    // The next record of each stream. Once popped it can't be dropped any more, and the oldest of them goes first.
+    array<Record, cStreams> heads;
+    array<bool, cStreams> popped = {};
+    size_t written = 0;
+
+    for (;;)
+    {
+        for (;;)
+        {
+            PopHeads(heads, popped);
+
+            size_t next = cStreams;
+
+            for (size_t i = 0; i < cStreams; ++i)
+            {
+                if (popped[i] && (next == cStreams || heads[i]._sequence < heads[next]._sequence))
+                {
+                    next = i;
+                }
+            }
+
+            if (next == cStreams)
+            {
+                break;
+            }
+
+            NoExcept([&]() { _processor(heads[next]); }, MOO_WHERE);
+            popped[next] = false;
+
+            if (++written % cDroppedReportCheckRecords == 0)
+            {
+                ReportDropped(false);
+            }
+        }
+
+        const bool stopping = _stop && Empty();
+
+        ReportDropped(stopping);
+        NoExcept([&]() { _idle(stopping); }, MOO_WHERE);
+
+        if (stopping)
+        {
+            return;
+        }
+
+        Wait();
+    }
+}
+
+void AsyncWriter::PopHeads(array<Record, cStreams>& aHeads, array<bool, cStreams>& aPopped)
+{
+    // Records a thread completed before the ones popped so far are in their rings by now, either ready or behind
+    // pushes still in progress, whose records were numbered before them. So the rings without a head are looked at
+    // again after every pop, and one that can't be popped from while it isn't empty is waited for.
+    for (bool settled = false; !settled;)
+    {
+        settled = true;
+        bool pushing = false;
+
+        for (size_t i = 0; i < cStreams; ++i)
+        {
+            if (aPopped[i])
+            {
+                continue;
+            }
+
+            MpmcRing<Record>& ring = _queues[i]->_ring;
+            aPopped[i] = ring.TryPop(aHeads[i]);
+
+            if (aPopped[i])
+            {
+                settled = false;
+            }
+            else if (!ring.Empty())
+            {
+                settled = false;
+                pushing = true;
+            }
+        }
+
+        if (pushing)
+        {
+            this_thread::yield();
+        }
+    }
+}
+
+void AsyncWriter::Wait()
+{
+    // Push checks _sleeping after publishing its record, and we check the rings after raising _sleeping,
+    // so one of the two always sees the other one
+    _sleeping = true;
+
+    if (!Empty() || _stop)
+    {
+        _sleeping = false;
+        return;
+    }
+
+    _sleeping.wait(true);
+}
+
+bool AsyncWriter::Empty() const noexcept
+{
+    for (const unique_ptr<Queue>& pQueue : _queues)
+    {
+        if (!pQueue->_ring.Empty())
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void AsyncWriter::WaitForRoom(Queue& aQueue, Record& aRecord)
+{
+    const bool stats = s_lockStats.load(memory_order_relaxed);
+    const auto start = stats ? chrono::steady_clock::now() : chrono::steady_clock::time_point();
+
+    do
+    {
+        this_thread::yield();
+    } while (!aQueue._ring.TryPush(move(aRecord)));
+
+    if (stats)
+    {
+        ThreadStatsRecorder::Local()._queueWait.Add(chrono::steady_clock::now() - start);
+    }
+}
+
+void AsyncWriter::ReportDropped(bool aNow)
+{
+    const auto now = chrono::steady_clock::now();
+
+    if (!aNow && now - _lastReport < cDroppedReportInterval)
+    {
+        return;
+    }
+
+    _lastReport = now;
+
+    for (size_t i = 0; i < cStreams; ++i)
+    {
+        Queue& queue = *_queues[i];
+        const uint64_t dropped = queue._dropped.load(memory_order_relaxed);
+
+        if (dropped == queue._reported)
+        {
+            continue;
+        }
+
+        Record record{ static_cast<Stream>(i), chrono::system_clock::now(),
+            _recordBuffers.Make("moo::Logger dropped " + to_string(dropped - queue._reported) + " messages", true) };
+        queue._reported = dropped;
+        NoExcept([&]() { _processor(record); }, MOO_WHERE);
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+StreamTarget::StreamTarget(Stream aStream, SinkLogger& aLogger, AsyncWriter* apAsyncWriter,
+    bool aThreadLocalBuffers) noexcept
+    : _stream(aStream)
+    , _logger(aLogger)
+    , _pAsyncWriter(apAsyncWriter)
+    , _threadLocalBuffers(aThreadLocalBuffers)
+{
+}
+
+void StreamTarget::operator()(string_view aStr)
+{
+    if (!_threadLocalBuffers)
+    {
+        AssertLock();
+    }
+
+    const TimePoint now = chrono::system_clock::now();
+
+    if (_pAsyncWriter)
+    {
+        _pAsyncWriter->Push(_stream, now, aStr, false, 0);
+    }
+    else
+    {
+        Logger::Lock lock;
+        _logger(aStr, now);
+        _logger.FlushIfDue(true);
+    }
+
+    if (_stream == Stream::Err && FlightRecorder::On() && aStr.ends_with('\n'))
+    {
+        Logger::DumpFlightRecorder("a line was written to cerr");
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+namespace {
+    Stream ToStream(const ostream& aOS) noexcept
+    {
+        if (&aOS == &cout)
+        {
+            return Stream::Out;
+        }
+
+        if (&aOS == &cerr)
+        {
+            return Stream::Err;
+        }
+
+        MOO_ASSERT(&aOS == &clog);
+        return Stream::Log;
+    }
+
+    uint64_t NextSequence() noexcept
+    {
+        static atomic<uint64_t> s_nextSequence = 0;
+        return s_nextSequence.fetch_add(1, memory_order_relaxed);
+    }
+
+    void AssertLock() noexcept
+    {
+        if (s_assertLock)
+        {
+            MOO_ASSERT(s_lockCount > 0);
+        }
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void AtomicHistogram::Add(chrono::steady_clock::duration aDuration) noexcept
+{
+    const uint64_t ns = static_cast<uint64_t>(max<int64_t>(0, chrono::nanoseconds(aDuration).count()));
+    const size_t bucket = min<size_t>(ns == 0 ? 0 : bit_width(ns) - 1, LatencyHistogram::cBuckets - 1);
+
+    // Only the owning thread writes, so no read-modify-write is needed
+    _counts[bucket].store(_counts[bucket].load(memory_order_relaxed) + 1, memory_order_relaxed);
+    _totalNs.store(_totalNs.load(memory_order_relaxed) + ns, memory_order_relaxed);
+}
+
+LatencyHistogram AtomicHistogram::Load() const noexcept
+{
+    LatencyHistogram histogram;
+
+    for (size_t i = 0; i < LatencyHistogram::cBuckets; ++i)
+    {
+        histogram.counts[i] = _counts[i].load(memory_order_relaxed);
+    }
+
+    histogram.totalNs = _totalNs.load(memory_order_relaxed);
+    return histogram;
+}
+
+//static
+ThreadStatsRecorder& ThreadStatsRecorder::Local()
+{
+    thread_local shared_ptr<ThreadStatsRecorder> tl_pStats = []()
+    {
+        auto pStats = make_shared<ThreadStatsRecorder>();
+        scoped_lock lock(s_threadStatsMutex);
+        s_threadStats.push_back(pStats);
+        return pStats;
+    }();
+
+    return *tl_pStats;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+//static
+void Logger::Write(const LogSite& aSite, string_view aMessage) noexcept
+{
+    NoExcept([&]()
+        {
+            if (FlightRecorder::On())
+            {
+                FlightRecorder::Record(aSite, aMessage);
+
+                if (!aSite.Enabled())
+                {
+                    return;
+                }
+            }
+
+            uint64_t repeats = 0;
+
+            if (aSite.Repeated(aMessage, repeats))
+            {
+                if (repeats != 0)
+                {
+                    Instance::WriteHeldBack(aSite, repeats);
+                }
+
+                return;
+            }
+
+            Instance::WriteHeldBack(aSite, repeats);
+            Instance::WriteLine(aSite, aMessage);
+
+            if (aSite.level == LogLevel::Error && FlightRecorder::On())
+            {
+                DumpFlightRecorder("an error was logged");
+            }
+        },
+        MOO_WHERE);
+}
+
+//static
+void Logger::DumpFlightRecorder(string_view aReason) noexcept
+{
+    NoExcept([&]()
+        {
+            if (!FlightRecorder::On())
+            {
+                return;
+            }
+
+            const vector<FlightRecorder::Entry> entries = FlightRecorder::Take();
+
+            if (entries.empty())
+            {
+                return;
+            }
+
+            RunningInstance<Instance>::Use pInstance(Instance::s_running);
+            const auto write = [&](TimePoint aTime, uint32_t aSite, string_view aText)
+            {
+                if (pInstance)
+                {
+                    pInstance->Write(Stream::Log, aTime, aText, aSite);
+                }
+                else
+                {
+                    clog << aText << '\n' << flush;
+                }
+            };
+
+            write(chrono::system_clock::now(), 0, "moo::FlightRecorder, the last " + to_string(entries.size())
+                + " records before: " + string(aReason));
+
+            for (const FlightRecorder::Entry& entry : entries)
+            {
+                const LogSite* pSite = LogSite::Find(entry.site);
+                const string_view level = pSite ? ToString(pSite->level) : "?";
+                write(entry.time, entry.site, "  " + string(level) + ": " + entry.text);
+            }
+
+            write(chrono::system_clock::now(), 0, "moo::FlightRecorder end");
+        },
+        MOO_WHERE);
+}
+
+//static
+void Logger::DefaultLogPath(string aLogPath) noexcept
+{
+    Instance::s_defaultLogPath = move(aLogPath);
+}
+//static
+const string& Logger::DefaultLogPath() noexcept
+{
+    return Instance::s_defaultLogPath;
+}
+
+//static
+void Logger::AssertLock(bool aAssert) noexcept
 {
     s_assertLock = aAssert;
 }
@@ -377,3 +1461,146 @@ streamsize Logger::TimeStampFractionSeconds() noexcept
 {
     return s_fractionSeconds;
 }
+
+//static
+void Logger::Async(bool aAsync) noexcept
+{
+    s_async = aAsync;
+}
+//static
+bool Logger::Async() noexcept
+{
+    return s_async;
+}
+
+//static
+void Logger::ThreadLocalBuffers(bool aThreadLocal) noexcept
+{
+    s_threadLocalBuffers = aThreadLocal;
+}
+//static
+bool Logger::ThreadLocalBuffers() noexcept
+{
+    return s_threadLocalBuffers;
+}
+
+//static
+void Logger::MappedLogFile(bool aMapped) noexcept
+{
+    s_mappedLogFile = aMapped;
+}
+//static
+bool Logger::MappedLogFile() noexcept
+{
+    return s_mappedLogFile;
+}
+
+//static
+void Logger::MappedLogFileSyncBytes(uint64_t aBytes) noexcept
+{
+    s_mappedLogFileSyncBytes = aBytes;
+}
+//static
+uint64_t Logger::MappedLogFileSyncBytes() noexcept
+{
+    return s_mappedLogFileSyncBytes;
+}
+
+//static
+void Logger::Rotation(LogRotation aRotation) noexcept
+{
+    s_rotation = aRotation;
+}
+//static
+const LogRotation& Logger::Rotation() noexcept
+{
+    return s_rotation;
+}
+
+//static
+void Logger::AsyncQueueSize(size_t aRecords) noexcept
+{
+    s_asyncQueueSize = aRecords;
+}
+//static
+size_t Logger::AsyncQueueSize() noexcept
+{
+    return s_asyncQueueSize;
+}
+
+//static
+void Logger::OverflowPolicy(const ostream& aStream, Overflow aPolicy) noexcept
+{
+    s_overflowPolicies[static_cast<size_t>(ToStream(aStream))] = aPolicy;
+}
+//static
+Logger::Overflow Logger::OverflowPolicy(const ostream& aStream) noexcept
+{
+    return s_overflowPolicies[static_cast<size_t>(ToStream(aStream))];
+}
+
+//static
+void Logger::OverflowSampleRate(size_t aRate) noexcept
+{
+    s_overflowSampleRate = aRate;
+}
+//static
+size_t Logger::OverflowSampleRate() noexcept
+{
+    return s_overflowSampleRate;
+}
+
+//static
+uint64_t Logger::Dropped(const ostream& aStream) noexcept
+{
+    RunningInstance<Instance>::Use pInstance(Instance::s_running);
+    return pInstance && pInstance->_asyncWriter ? pInstance->_asyncWriter->Dropped(ToStream(aStream)) : 0;
+}
+
+//static
+void Logger::FlushPolicy(const ostream& aStream, LogFlushPolicy aPolicy) noexcept
+{
+    s_flushPolicies[static_cast<size_t>(ToStream(aStream))] = aPolicy;
+}
+//static
+const LogFlushPolicy& Logger::FlushPolicy(const ostream& aStream) noexcept
+{
+    return s_flushPolicies[static_cast<size_t>(ToStream(aStream))];
+}
+
+//static
+void Logger::LockStats(bool aEnabled) noexcept
+{
+    s_lockStats = aEnabled;
+}
+//static
+bool Logger::LockStats() noexcept
+{
+    return s_lockStats;
+}
+
+//static
+LoggerStats Logger::Stats()
+{
+    LoggerStats stats;
+    scoped_lock lock(s_threadStatsMutex);
+
+    for (const shared_ptr<ThreadStatsRecorder>& pThread : s_threadStats)
+    {
+        stats.threads.push_back({ pThread->_thread, pThread->_acquisitions.load(memory_order_relaxed),
+            pThread->_lockWait.Load(), pThread->_lockHold.Load(), pThread->_queueWait.Load() });
+    }
+
+    return stats;
+}
+
+//static
+void Logger::Sinks(vector<shared_ptr<LogSink>> aSinks) noexcept
+{
+    s_sinks = move(aSinks);
+}
+//static
+const vector<shared_ptr<LogSink>>& Logger::Sinks() noexcept
+{
+    return s_sinks;
+}
@@ -1,28 +1,65 @@
 #pragma once
+#include "LogRotation.h"
+#include "LoggerStats.h"
 #include "MooDefaults.h"
 
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
 #include <string>
+#include <string_view>
 #include <memory>
 #include <mutex>
-
-namespace std {
-    using streamsize = long long;
-}
+#include <vector>
 
 namespace moo {
+    class LogSink;
+    struct LogSite;
+
+    // When the Logger flushes the sinks of a stream (LogSink::Flush).
+    // With zero bytes and interval it flushes as soon as it has no more records at hand and isn't in the middle of
+    // a line: after every line when writing synchronously, and when the queue runs empty in Async mode. Otherwise
+    // it flushes once that many bytes were written since the last flush, or that much time passed, whichever comes
+    // first.
+    // Durable also waits for the sinks to be on the disk (LogSink::Sync). In Async mode one such sync covers every
+    // record written since the last one, of every stream, so a burst of errors pays for a single disk flush.
+    struct LogFlushPolicy {
+        uint64_t bytes = 0;
+        std::chrono::milliseconds interval = std::chrono::milliseconds(0);
+        bool durable = false;
+
+        [[nodiscard]] bool Immediate() const noexcept
+        {
+            return bytes == 0 && interval.count() == 0;
+        }
+    };
+
     // You can use this Logger class to redirect cout/clog/cerr when you don't have a console to write to.
-    // All three are redirected to the Debug Window, and clog and cerr to a log file too.
+    // All three are redirected to the Debug Window (standard error where there is none), and clog and cerr
+    // to a log file and any other LogSink too.
     // Each stream starts the lines with a timestamp and an indication of the type (out/log/-ERR-).
     //
     // The Logger starts working when the first instance is created and stops when the last one is destroyed.
     // Having more than one instance at a time doesn't change any behavior, it effectively works like a Singleton,
     // except that you have RAII control over initialization and destruction.
     // After destruction, the streams go back to their original targets.
+    // Destruction waits for the MOO_LOG calls still in progress on other threads.
     // You can have as many instantiation/destruction as you like, effectively starting/stopping the redirection,
     // or changing the output file.
     //
     // You are supposed to use Logger::Lock as a scoped lock to avoid concurrency. You will get an assertion
     // if you forget to do so, but you can disable it if you don't need locking.
+    // With ThreadLocalBuffers each thread formats into its own buffer and the Lock is not needed: a whole line
+    // is handed over at endl/flush, and only that step is serialized.
+    //
+    // In Async mode the calling thread only queues each record, and a writer thread owned by the Logger adds
+    // the prefixes and writes to the Debug Window and the log file. The mode is chosen when the Logger starts,
+    // and stopping it waits until every queued record is written.
+    // Each stream has its own queue and Overflow policy, so a storm on cout can't make cerr wait, and the records
+    // dropped by a policy are counted and reported in the log.
+    // A record is complete at endl/flush, and gets a global sequence number then: the writer thread merges the queues
+    // in that order, so the records of a thread keep their order across the streams. A line left unfinished in one
+    // stream isn't flushed when another stream is written to, it's written once it is complete.
 
     class Logger {
     public:
@@ -36,9 +73,21 @@ namespace moo {
             ~Lock();
             MOO_DELETE_DEFAULTS(Lock);
         private:
+            std::chrono::steady_clock::time_point _acquiredAt; // only set with LockStats
             std::unique_lock<std::recursive_mutex> _lock;
         };
 
+        // Writes one message of a LogSite (see MOO_LOG) as a whole line, to clog or cerr when no Logger is running.
+        // The record only carries the id of the site, the writing side looks the rest up.
+        // What the LogSiteLimits of the site held back is reported before it.
+        // A message of a disabled site, which only runs while the FlightRecorder is on, is only recorded.
+        static void Write(const LogSite& aSite, std::string_view aMessage) noexcept;
+
+        // Writes what the FlightRecorder holds to the log, or clog when no Logger is running, oldest first,
+        // after a line with aReason. Called by NoExcept when it catches an exception and after a line
+        // is written to cerr; does nothing when there's nothing recorded.
+        static void DumpFlightRecorder(std::string_view aReason) noexcept;
+
         static void DefaultLogPath(std::string aLogPath) noexcept;
         static const std::string& DefaultLogPath() noexcept;
 
@@ -50,6 +99,69 @@ namespace moo {
 
         static void TimeStampFractionSeconds(std::streamsize aWidth) noexcept;
         static std::streamsize TimeStampFractionSeconds() noexcept;
+
+        static void Async(bool aAsync) noexcept;
+        static bool Async() noexcept;
+
+        // Like Async, it takes effect the next time the Logger starts
+        static void ThreadLocalBuffers(bool aThreadLocal) noexcept;
+        static bool ThreadLocalBuffers() noexcept;
+
+        // Writes the log file through memory mappings (see MappedFile) instead of an ofstream.
+        // Takes effect the next time the Logger starts.
+        static void MappedLogFile(bool aMapped) noexcept;
+        static bool MappedLogFile() noexcept;
+
+        // Bytes between flushes of the mapped log file, 0 (the default) leaves it to the OS
+        static void MappedLogFileSyncBytes(uint64_t aBytes) noexcept;
+        static uint64_t MappedLogFileSyncBytes() noexcept;
+
+        // Rolls the log over to numbered files by size and/or age, see LogFile.
+        // Takes effect the next time the Logger starts.
+        static void Rotation(LogRotation aRotation) noexcept;
+        static const LogRotation& Rotation() noexcept;
+
+        // Records that can be queued per stream before its Overflow policy applies
+        static void AsyncQueueSize(size_t aRecords) noexcept;
+        static size_t AsyncQueueSize() noexcept;
+
+        // What a thread does in Async mode when the queue of the stream it writes to is full
+        enum class Overflow {
+            Block,      // waits for room, the default
+            DropNewest, // drops the record it was about to queue
+            DropOldest, // drops the oldest queued records of the stream until there is room
+            Sample      // waits for room for one of every OverflowSampleRate records that find the queue full,
+                        // and drops the others
+        };
+
+        // The policy of cout, clog or cerr (MOO_LOG goes to the last two).
+        // Takes effect the next time the Logger starts.
+        static void OverflowPolicy(const std::ostream& aStream, Overflow aPolicy) noexcept;
+        static Overflow OverflowPolicy(const std::ostream& aStream) noexcept;
+
+        static void OverflowSampleRate(size_t aRate) noexcept;
+        static size_t OverflowSampleRate() noexcept;
+
+        // Records of cout, clog or cerr dropped since the running Logger started, 0 when none is running.
+        // The log gets a "moo::Logger dropped N messages" line at most once a second while they are being dropped.
+        [[nodiscard]] static uint64_t Dropped(const std::ostream& aStream) noexcept;
+
+        // The flush policy of cout, clog or cerr. By default cout and clog are flushed every 64 KB or 100 ms,
+        // and cerr immediately. Takes effect the next time the Logger starts.
+        static void FlushPolicy(const std::ostream& aStream, LogFlushPolicy aPolicy) noexcept;
+        static const LogFlushPolicy& FlushPolicy(const std::ostream& aStream) noexcept;
+
+        // Records how long each thread waits for and holds the Lock, and in Async mode waits for room in the queue,
+        // for Stats. Off by default, and while it's off the Lock doesn't even read the clock.
+        static void LockStats(bool aEnabled) noexcept;
+        static bool LockStats() noexcept;
+
+        [[nodiscard]] static LoggerStats Stats();
+
+        // More places for what goes to the log file, e.g. an FdSink for standard output.
+        // Takes effect the next time the Logger starts.
+        static void Sinks(std::vector<std::shared_ptr<LogSink>> aSinks) noexcept;
+        static const std::vector<std::shared_ptr<LogSink>>& Sinks() noexcept;
     private:
         struct Instance;
         std::shared_ptr<Instance> _instance;
@@ -0,0 +1,86 @@
+#include "LoggerStats.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+using namespace moo;
+
+uint64_t LatencyHistogram::Count() const noexcept
+{
+    uint64_t count = 0;
+
+    for (uint64_t bucketCount : counts)
+    {
+        count += bucketCount;
+    }
+
+    return count;
+}
+
+double LatencyHistogram::MeanNs() const noexcept
+{
+    const uint64_t count = Count();
+    return count == 0 ? 0.0 : static_cast<double>(totalNs) / static_cast<double>(count);
+}
+
+uint64_t LatencyHistogram::PercentileNs(double aFraction) const noexcept
+{
+    const uint64_t count = Count();
+
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    const uint64_t rank = max<uint64_t>(1, static_cast<uint64_t>(ceil(clamp(aFraction, 0.0, 1.0) * count)));
+    uint64_t seen = 0;
+
+    for (size_t i = 0; i < cBuckets; ++i)
+    {
+        seen += counts[i];
+
+        if (seen >= rank)
+        {
+            return (uint64_t(1) << (i + 1)) - 1;
+        }
+    }
+
+    return UINT64_MAX;
+}
+
+LatencyHistogram& LatencyHistogram::operator+=(const LatencyHistogram& aOther) noexcept
+{
+    for (size_t i = 0; i < cBuckets; ++i)
+    {
+        counts[i] += aOther.counts[i];
+    }
+
+    totalNs += aOther.totalNs;
+    return *this;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+LoggerThreadStats& LoggerThreadStats::operator+=(const LoggerThreadStats& aOther) noexcept
+{
+    acquisitions += aOther.acquisitions;
+    lockWait += aOther.lockWait;
+    lockHold += aOther.lockHold;
+    queueWait += aOther.queueWait;
+    return *this;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+LoggerThreadStats LoggerStats::Total() const noexcept
+{
+    LoggerThreadStats total;
+
+    for (const LoggerThreadStats& thread : threads)
+    {
+        total += thread;
+    }
+
+    return total;
+}
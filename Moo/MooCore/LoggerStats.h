@@ -0,0 +1,44 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace moo {
+    // Counts of durations in power of two buckets: bucket i counts [2^i, 2^(i+1)) nanoseconds,
+    // the first one also counts 0 and the last one everything longer
+    struct LatencyHistogram {
+        static constexpr size_t cBuckets = 40; // the last one starts at about 9 minutes
+
+        std::array<uint64_t, cBuckets> counts = {};
+        uint64_t totalNs = 0;
+
+        [[nodiscard]] uint64_t Count() const noexcept;
+        [[nodiscard]] double MeanNs() const noexcept;
+        // The upper end of the bucket the percentile falls in, so at most twice the actual value
+        [[nodiscard]] uint64_t PercentileNs(double aFraction) const noexcept;
+
+        LatencyHistogram& operator+=(const LatencyHistogram& aOther) noexcept;
+    };
+
+    // What one thread spent on the Logger::Lock, and in Async mode waiting for room in the queue
+    struct LoggerThreadStats {
+        std::thread::id thread;
+        uint64_t acquisitions = 0;
+        LatencyHistogram lockWait;
+        LatencyHistogram lockHold;
+        LatencyHistogram queueWait;
+
+        LoggerThreadStats& operator+=(const LoggerThreadStats& aOther) noexcept;
+    };
+
+    // Logger::Stats, one entry for every thread that took the Lock or queued a record since the stats were on.
+    // Counts only grow, the difference of two snapshots gives the interval between them.
+    struct LoggerStats {
+        std::vector<LoggerThreadStats> threads;
+
+        // All threads together
+        [[nodiscard]] LoggerThreadStats Total() const noexcept;
+    };
+}
@@ -0,0 +1,269 @@
+#include "MappedArray.h"
+
+#include <system_error>
+#include <utility>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+using namespace moo;
+
+namespace {
+    [[noreturn]] void ThrowLastError(const char* aWhat)
+    {
+#ifdef _WIN32
+        throw system_error(static_cast<int>(GetLastError()), system_category(), aWhat);
+#else
+        throw system_error(errno, generic_category(), aWhat);
+#endif
+    }
+
+#ifdef _WIN32
+    // Closes the handle when it goes out of scope, the view keeps the file and the mapping object alive
+    struct ScopedHandle {
+        HANDLE handle;
+
+        ~ScopedHandle()
+        {
+            CloseHandle(handle);
+        }
+    };
+#else
+    struct ScopedFile {
+        int file;
+
+        ~ScopedFile()
+        {
+            close(file);
+        }
+    };
+#endif
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+MappedRegion::MappedRegion(const string& aPath, MapMode aMode, MapAccess aAccess)
+{
+    Open(aPath, aMode, aAccess);
+}
+
+MappedRegion::~MappedRegion()
+{
+    Close();
+}
+
+MappedRegion::MappedRegion(MappedRegion&& aOther) noexcept
+    : _pData(exchange(aOther._pData, nullptr))
+    , _bytes(exchange(aOther._bytes, 0))
+    , _open(exchange(aOther._open, false))
+    , _mode(aOther._mode)
+{
+}
+
+MappedRegion& MappedRegion::operator=(MappedRegion&& aOther) noexcept
+{
+    if (this != &aOther)
+    {
+        Close();
+        _pData = exchange(aOther._pData, nullptr);
+        _bytes = exchange(aOther._bytes, 0);
+        _open = exchange(aOther._open, false);
+        _mode = aOther._mode;
+    }
+
+    return *this;
+}
+
+bool MappedRegion::is_open() const noexcept
+{
+    return _open;
+}
+
+MapMode MappedRegion::Mode() const noexcept
+{
+    return _mode;
+}
+
+void* MappedRegion::Data() const noexcept
+{
+    return _pData;
+}
+
+size_t MappedRegion::Bytes() const noexcept
+{
+    return _bytes;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+#ifdef _WIN32
+
+void MappedRegion::Open(const string& aPath, MapMode aMode, MapAccess aAccess)
+{
+    Close();
+
+    HANDLE file = CreateFileA(aPath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return;
+    }
+
+    ScopedHandle fileHandle{ file };
+
+    LARGE_INTEGER size = {};
+    if (!GetFileSizeEx(file, &size))
+    {
+        ThrowLastError("MappedRegion failed to get the file size");
+    }
+
+    _mode = aMode;
+
+    // Mapping an empty file fails, it's an empty region instead
+    if (size.QuadPart > 0)
+    {
+        const bool copyOnWrite = aMode == MapMode::CopyOnWrite;
+
+        HANDLE mapping = CreateFileMappingA(file, nullptr, copyOnWrite ? PAGE_WRITECOPY : PAGE_READONLY,
+            0, 0, nullptr);
+
+        if (!mapping)
+        {
+            ThrowLastError("MappedRegion failed to create a file mapping");
+        }
+
+        ScopedHandle mappingHandle{ mapping };
+
+        void* pView = MapViewOfFile(mapping, copyOnWrite ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0);
+
+        if (!pView)
+        {
+            ThrowLastError("MappedRegion failed to map the file");
+        }
+
+        _pData = pView;
+        _bytes = static_cast<size_t>(size.QuadPart);
+    }
+
+    _open = true;
+    Advise(aAccess);
+}
+
+void MappedRegion::Close() noexcept
+{
+    if (_pData)
+    {
+        UnmapViewOfFile(_pData);
+    }
+
+    _pData = nullptr;
+    _bytes = 0;
+    _open = false;
+}
+
+void MappedRegion::Advise(MapAccess aAccess) noexcept
+{
+    // Windows has no read-ahead hints for a view, only prefetching
+    if (aAccess != MapAccess::WillNeed || !_pData)
+    {
+        return;
+    }
+
+    WIN32_MEMORY_RANGE_ENTRY range = { _pData, _bytes };
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+}
+
+#else
+
+void MappedRegion::Open(const string& aPath, MapMode aMode, MapAccess aAccess)
+{
+    Close();
+
+    const int file = open(aPath.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if (file == -1)
+    {
+        return;
+    }
+
+    // The mapping keeps the file alive
+    ScopedFile scopedFile{ file };
+
+    struct stat info = {};
+    if (fstat(file, &info) != 0)
+    {
+        ThrowLastError("MappedRegion failed to get the file size");
+    }
+
+    _mode = aMode;
+
+    // Mapping an empty file fails, it's an empty region instead
+    if (info.st_size > 0)
+    {
+        const bool copyOnWrite = aMode == MapMode::CopyOnWrite;
+        const size_t bytes = static_cast<size_t>(info.st_size);
+
+        void* pView = mmap(nullptr, bytes, copyOnWrite ? PROT_READ | PROT_WRITE : PROT_READ,
+            copyOnWrite ? MAP_PRIVATE : MAP_SHARED, file, 0);
+
+        if (pView == MAP_FAILED)
+        {
+            ThrowLastError("MappedRegion failed to map the file");
+        }
+
+        _pData = pView;
+        _bytes = bytes;
+    }
+
+    _open = true;
+    Advise(aAccess);
+}
+
+void MappedRegion::Close() noexcept
+{
+    if (_pData)
+    {
+        munmap(_pData, _bytes);
+    }
+
+    _pData = nullptr;
+    _bytes = 0;
+    _open = false;
+}
+
+void MappedRegion::Advise(MapAccess aAccess) noexcept
+{
+    if (!_pData)
+    {
+        return;
+    }
+
+    int advice = MADV_NORMAL;
+    switch (aAccess)
+    {
+    case MapAccess::Normal:
+        break;
+    case MapAccess::Sequential:
+        advice = MADV_SEQUENTIAL;
+        break;
+    case MapAccess::Random:
+        advice = MADV_RANDOM;
+        break;
+    case MapAccess::WillNeed:
+        advice = MADV_WILLNEED;
+        break;
+    }
+
+    // Only a hint, the mapping works the same without it
+    madvise(_pData, _bytes, advice);
+}
+
+#endif
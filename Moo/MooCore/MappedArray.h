@@ -0,0 +1,212 @@
+#pragma once
+#include "ScopedArray.hpp"
+
+#include <span>
+#include <string>
+#include <type_traits>
+
+namespace moo {
+    enum class MapMode {
+        // Writing to the pages faults
+        ReadOnly,
+        // Written pages become private copies, the file and other processes never see the writes
+        CopyOnWrite,
+    };
+
+    // How the mapping is going to be read, a hint for the OS read-ahead (madvise). Only WillNeed does something
+    // on Windows, where it prefetches the whole file.
+    enum class MapAccess {
+        Normal,
+        // Reads ahead aggressively and drops pages soon after they were read
+        Sequential,
+        // No read-ahead, only the pages touched are read
+        Random,
+        // Starts reading the whole file in the background
+        WillNeed,
+    };
+
+    // A whole file mapped into memory. Opening it costs the same whatever the file size, the pages are read on
+    // first access, and read-only pages are shared with the OS file cache and every process that maps the file.
+    //
+    // Like an ofstream, failing to open leaves it closed (is_open() is false). Failing to map a file that opened
+    // throws a std::system_error.
+    class MappedRegion {
+    public:
+        MappedRegion() noexcept = default;
+        MappedRegion(const std::string& aPath, MapMode aMode = MapMode::ReadOnly,
+            MapAccess aAccess = MapAccess::Normal);
+        ~MappedRegion();
+
+        MappedRegion(MappedRegion&& aOther) noexcept;
+        MappedRegion& operator=(MappedRegion&& aOther) noexcept;
+        MappedRegion(const MappedRegion&) = delete;
+        MappedRegion& operator=(const MappedRegion&) = delete;
+
+        // Closes the current file first, and stays closed when aPath fails to open
+        void Open(const std::string& aPath, MapMode aMode = MapMode::ReadOnly, MapAccess aAccess = MapAccess::Normal);
+        void Close() noexcept;
+
+        [[nodiscard]] bool is_open() const noexcept;
+        [[nodiscard]] MapMode Mode() const noexcept;
+
+        // Null for an empty file
+        [[nodiscard]] void* Data() const noexcept;
+        [[nodiscard]] size_t Bytes() const noexcept;
+
+        // Changes the hint for the whole mapping
+        void Advise(MapAccess aAccess) noexcept;
+
+    private:
+        void* _pData = nullptr;
+        size_t _bytes = 0;
+        bool _open = false;
+        MapMode _mode = MapMode::ReadOnly;
+    };
+
+    // A file of T's, with the interface of a ScopedArray over the mapped file instead of a copy of it, for large
+    // tables that would otherwise be read into memory whole. See MappedRegion.
+    // The non-const accessors only allow writes with MapMode::CopyOnWrite. Bytes at the end of the file that
+    // don't make a whole T are left out.
+    template<class T>
+    class MappedArray {
+        static_assert(std::is_trivially_copyable_v<T>, "a MappedArray holds the bytes of the file as they are");
+
+    public:
+        using Type = T;
+        using Iterator = SpanIterator<T>;
+        using ConstIterator = SpanIterator<const T>;
+
+        MappedArray() noexcept = default;
+        explicit MappedArray(const std::string& aPath, MapMode aMode = MapMode::ReadOnly,
+            MapAccess aAccess = MapAccess::Normal);
+        MappedArray(MappedArray&&) noexcept = default;
+        MappedArray& operator=(MappedArray&&) noexcept = default;
+        MappedArray(const MappedArray&) = delete;
+        MappedArray& operator=(const MappedArray&) = delete;
+
+        [[nodiscard]] constexpr Iterator begin() noexcept { return begin<T>(this); }
+        [[nodiscard]] constexpr ConstIterator begin() const noexcept { return begin<const T>(this); }
+
+        [[nodiscard]] constexpr Iterator end() noexcept { return end<T>(this); }
+        [[nodiscard]] constexpr ConstIterator end() const noexcept { return end<const T>(this); }
+
+        [[nodiscard]] constexpr T& operator[](size_t aIndex) noexcept;
+        [[nodiscard]] constexpr const T& operator[](size_t aIndex) const noexcept;
+
+        [[nodiscard]] constexpr size_t size() const noexcept;
+
+        [[nodiscard]] constexpr T* data() noexcept;
+        [[nodiscard]] constexpr const T* data() const noexcept;
+
+        [[nodiscard]] bool is_open() const noexcept;
+        void Open(const std::string& aPath, MapMode aMode = MapMode::ReadOnly, MapAccess aAccess = MapAccess::Normal);
+        void Close() noexcept;
+        void Advise(MapAccess aAccess) noexcept;
+
+        [[nodiscard]] constexpr std::span<const char> CBytes() const noexcept;
+        [[nodiscard]] constexpr std::span<const unsigned char> CUBytes() const noexcept;
+
+    private:
+        template<class Tv, class TSelf>
+        [[nodiscard]] static constexpr SpanIterator<Tv> begin(TSelf* apSelf) noexcept;
+        template<class Tv, class TSelf>
+        [[nodiscard]] static constexpr SpanIterator<Tv> end(TSelf* apSelf) noexcept;
+
+        MappedRegion _region;
+    };
+}
+
+template<class T>
+moo::MappedArray<T>::MappedArray(const std::string& aPath, MapMode aMode, MapAccess aAccess)
+    : _region(aPath, aMode, aAccess)
+{
+}
+
+template<class T>
+[[nodiscard]] constexpr T& moo::MappedArray<T>::operator[](size_t aIndex) noexcept
+{
+    MOO_RETURN_RANDOM_ACCESS(data(), aIndex, size());
+}
+template<class T>
+[[nodiscard]] constexpr const T& moo::MappedArray<T>::operator[](size_t aIndex) const noexcept
+{
+    MOO_RETURN_RANDOM_ACCESS(data(), aIndex, size());
+}
+
+template<class T>
+[[nodiscard]] constexpr size_t moo::MappedArray<T>::size() const noexcept
+{
+    return _region.Bytes() / sizeof(T);
+}
+
+template<class T>
+[[nodiscard]] constexpr T* moo::MappedArray<T>::data() noexcept
+{
+    return static_cast<T*>(_region.Data());
+}
+template<class T>
+[[nodiscard]] constexpr const T* moo::MappedArray<T>::data() const noexcept
+{
+    return static_cast<const T*>(_region.Data());
+}
+
+template<class T>
+[[nodiscard]] bool moo::MappedArray<T>::is_open() const noexcept
+{
+    return _region.is_open();
+}
+template<class T>
+void moo::MappedArray<T>::Open(const std::string& aPath, MapMode aMode, MapAccess aAccess)
+{
+    _region.Open(aPath, aMode, aAccess);
+}
+template<class T>
+void moo::MappedArray<T>::Close() noexcept
+{
+    _region.Close();
+}
+template<class T>
+void moo::MappedArray<T>::Advise(MapAccess aAccess) noexcept
+{
+    _region.Advise(aAccess);
+}
+
+template<class T>
+[[nodiscard]] constexpr std::span<const char> moo::MappedArray<T>::CBytes() const noexcept
+{
+    return { reinterpret_cast<const char*>(data()), size() * sizeof(T) };
+}
+template<class T>
+[[nodiscard]] constexpr std::span<const unsigned char> moo::MappedArray<T>::CUBytes() const noexcept
+{
+    return { reinterpret_cast<const unsigned char*>(data()), size() * sizeof(T) };
+}
+
+//-------------------------------------------------------------------------------------------------------
+// private:
+
+template<class T>
+template<class Tv, class TSelf>
+[[nodiscard]] constexpr moo::SpanIterator<Tv> moo::MappedArray<T>::begin(TSelf* apSelf) noexcept
+{
+    Tv* ptr = apSelf->data();
+#if MOO_ITERATOR_DEBUG_LEVEL >= 1
+    MOO_SUPPRESS(26481); // Don't use pointer arithmetic. Use span instead
+    return { ptr, ptr, ptr + apSelf->size() };
+#else
+    return { ptr };
+#endif
+}
+template<class T>
+template<class Tv, class TSelf>
+[[nodiscard]] constexpr moo::SpanIterator<Tv> moo::MappedArray<T>::end(TSelf* apSelf) noexcept
+{
+    Tv* ptr = apSelf->data();
+    MOO_SUPPRESS(26481); // Don't use pointer arithmetic. Use span instead
+    Tv* end = ptr + apSelf->size();
+#if MOO_ITERATOR_DEBUG_LEVEL >= 1
+    return { end, ptr, end };
+#else
+    return { end };
+#endif
+}
@@ -0,0 +1,402 @@
+#include "MappedFile.h"
+
+#include "MooAssert.h"
+
+#include <algorithm>
+#include <cstring>
+#include <system_error>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+using namespace moo;
+
+namespace {
+    // Mapping offsets must be multiples of this (it's the allocation granularity on Windows)
+    constexpr size_t cGranularity = 64 * 1024;
+
+    constexpr size_t RoundUpSegmentSize(size_t aSize) noexcept
+    {
+        return (max(aSize, cGranularity) + cGranularity - 1) / cGranularity * cGranularity;
+    }
+
+    [[noreturn]] void ThrowLastError(const char* aWhat)
+    {
+#ifdef _WIN32
+        throw system_error(static_cast<int>(GetLastError()), system_category(), aWhat);
+#else
+        throw system_error(errno, generic_category(), aWhat);
+#endif
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+MappedFile::MappedFile(const string& aPath, bool aAppend, size_t aSegmentSize)
+    : _segmentSize(RoundUpSegmentSize(aSegmentSize))
+{
+    if (!OpenFile(aPath, aAppend))
+    {
+        return;
+    }
+
+    _cursor = _startOffset;
+
+    const uint64_t startIndex = _startOffset / _segmentSize;
+    for (uint64_t index = startIndex; index < startIndex + cSlotCount; ++index)
+    {
+        _slots[index % cSlotCount]._next = index;
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+bool MappedFile::is_open() const noexcept
+{
+#ifdef _WIN32
+    return _file != nullptr;
+#else
+    return _file != -1;
+#endif
+}
+
+uint64_t MappedFile::Size() const noexcept
+{
+    return _cursor.load();
+}
+
+void MappedFile::Write(string_view aData)
+{
+    if (!is_open() || aData.empty())
+    {
+        return;
+    }
+
+    const uint64_t offset = _cursor.fetch_add(aData.size());
+
+    uint64_t position = offset;
+    const char* pData = aData.data();
+    size_t left = aData.size();
+
+    while (left > 0)
+    {
+        const uint64_t index = position / _segmentSize;
+        const size_t inSegment = static_cast<size_t>(position % _segmentSize);
+        const size_t chunk = min(left, _segmentSize - inSegment);
+
+        memcpy(SegmentData(index) + inSegment, pData, chunk);
+        Written(index, chunk);
+
+        position += chunk;
+        pData += chunk;
+        left -= chunk;
+    }
+
+    const uint64_t syncEvery = _syncEvery.load(memory_order_relaxed);
+    if (syncEvery > 0 && offset / syncEvery != position / syncEvery)
+    {
+        Flush();
+    }
+}
+
+void MappedFile::Flush()
+{
+    scoped_lock lock(_mapMutex);
+
+    for (Slot& slot : _slots)
+    {
+        if (slot._index != cNoSegment)
+        {
+            FlushView(slot._pData);
+        }
+    }
+}
+
+void MappedFile::Sync()
+{
+    if (!is_open())
+    {
+        return;
+    }
+
+    // Segments already unmapped are in the OS cache, the file sync covers them too
+    Flush();
+    SyncFile();
+}
+
+void MappedFile::Close() noexcept
+{
+    if (!is_open())
+    {
+        return;
+    }
+
+    scoped_lock lock(_mapMutex);
+
+    for (Slot& slot : _slots)
+    {
+        if (slot._index != cNoSegment)
+        {
+            UnmapView(slot._pData);
+            slot._pData = nullptr;
+            slot._index = cNoSegment;
+        }
+    }
+
+    CloseFile(_cursor);
+}
+
+void MappedFile::SyncEvery(uint64_t aBytes) noexcept
+{
+    _syncEvery = aBytes;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// private:
+
+char* MappedFile::SegmentData(uint64_t aIndex)
+{
+    Slot& slot = _slots[aIndex % cSlotCount];
+
+    if (slot._index.load(memory_order_acquire) == aIndex)
+    {
+        return slot._pData;
+    }
+
+    return MapSegment(aIndex);
+}
+
+char* MappedFile::MapSegment(uint64_t aIndex)
+{
+    Slot& slot = _slots[aIndex % cSlotCount];
+
+    for (;;)
+    {
+        {
+            scoped_lock lock(_mapMutex);
+
+            const uint64_t current = slot._index.load(memory_order_acquire);
+
+            if (current == aIndex)
+            {
+                return slot._pData;
+            }
+
+            if (current == cNoSegment && slot._next == aIndex)
+            {
+                const uint64_t end = (aIndex + 1) * _segmentSize;
+                if (end > _fileSize)
+                {
+                    GrowFile(end);
+                }
+
+                slot._pData = MapView(aIndex * _segmentSize);
+                slot._written = aIndex == _startOffset / _segmentSize ? _startOffset % _segmentSize : 0;
+                slot._index.store(aIndex, memory_order_release);
+                return slot._pData;
+            }
+        }
+
+        // The slot still holds an earlier segment, one with writes in progress
+        this_thread::yield();
+    }
+}
+
+void MappedFile::Written(uint64_t aIndex, size_t aSize)
+{
+    Slot& slot = _slots[aIndex % cSlotCount];
+
+    if (slot._written.fetch_add(aSize) + aSize != _segmentSize)
+    {
+        return;
+    }
+
+    // This was the last write into the segment
+    scoped_lock lock(_mapMutex);
+
+    if (_syncEvery > 0)
+    {
+        FlushView(slot._pData);
+    }
+
+    UnmapView(slot._pData);
+    slot._pData = nullptr;
+    slot._next = aIndex + cSlotCount;
+    slot._index.store(cNoSegment, memory_order_release);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+#ifdef _WIN32
+
+bool MappedFile::OpenFile(const string& aPath, bool aAppend) noexcept
+{
+    HANDLE file = CreateFileA(aPath.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+        aAppend ? OPEN_ALWAYS : CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER size = {};
+    GetFileSizeEx(file, &size);
+
+    _file = file;
+    _startOffset = static_cast<uint64_t>(size.QuadPart);
+    _fileSize = _startOffset;
+    return true;
+}
+
+void MappedFile::GrowFile(uint64_t aSize)
+{
+    FILE_END_OF_FILE_INFO info = {};
+    info.EndOfFile.QuadPart = static_cast<LONGLONG>(aSize);
+
+    if (!SetFileInformationByHandle(_file, FileEndOfFileInfo, &info, sizeof(info)))
+    {
+        ThrowLastError("MappedFile failed to grow the file");
+    }
+
+    _fileSize = aSize;
+}
+
+char* MappedFile::MapView(uint64_t aOffset)
+{
+    const uint64_t end = aOffset + _segmentSize;
+
+    HANDLE mapping = CreateFileMappingA(_file, nullptr, PAGE_READWRITE,
+        static_cast<DWORD>(end >> 32), static_cast<DWORD>(end), nullptr);
+
+    if (!mapping)
+    {
+        ThrowLastError("MappedFile failed to create a file mapping");
+    }
+
+    // The view keeps the mapping object alive
+    void* pView = MapViewOfFile(mapping, FILE_MAP_WRITE,
+        static_cast<DWORD>(aOffset >> 32), static_cast<DWORD>(aOffset), _segmentSize);
+    CloseHandle(mapping);
+
+    if (!pView)
+    {
+        ThrowLastError("MappedFile failed to map a segment");
+    }
+
+    return static_cast<char*>(pView);
+}
+
+void MappedFile::FlushView(char* apData) noexcept
+{
+    FlushViewOfFile(apData, 0);
+}
+
+void MappedFile::SyncFile() noexcept
+{
+    FlushFileBuffers(_file);
+}
+
+void MappedFile::UnmapView(char* apData) noexcept
+{
+    UnmapViewOfFile(apData);
+}
+
+void MappedFile::CloseFile(uint64_t aSize) noexcept
+{
+    LARGE_INTEGER size = {};
+    size.QuadPart = static_cast<LONGLONG>(aSize);
+
+    if (SetFilePointerEx(_file, size, nullptr, FILE_BEGIN))
+    {
+        SetEndOfFile(_file);
+    }
+
+    CloseHandle(_file);
+    _file = nullptr;
+}
+
+#else
+
+bool MappedFile::OpenFile(const string& aPath, bool aAppend) noexcept
+{
+    const int file = open(aPath.c_str(), O_RDWR | O_CREAT | (aAppend ? 0 : O_TRUNC), 0644);
+
+    if (file == -1)
+    {
+        return false;
+    }
+
+    struct stat info = {};
+    fstat(file, &info);
+
+    _file = file;
+    _startOffset = static_cast<uint64_t>(info.st_size);
+    _fileSize = _startOffset;
+    return true;
+}
+
+void MappedFile::GrowFile(uint64_t aSize)
+{
+    // posix_fallocate reports its error instead of setting errno
+    const int error = posix_fallocate(_file, static_cast<off_t>(_fileSize), static_cast<off_t>(aSize - _fileSize));
+
+    if (error != 0)
+    {
+        throw system_error(error, generic_category(), "MappedFile failed to grow the file");
+    }
+
+    _fileSize = aSize;
+}
+
+char* MappedFile::MapView(uint64_t aOffset)
+{
+    void* pView = mmap(nullptr, _segmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, _file, static_cast<off_t>(aOffset));
+
+    if (pView == MAP_FAILED)
+    {
+        ThrowLastError("MappedFile failed to map a segment");
+    }
+
+    return static_cast<char*>(pView);
+}
+
+void MappedFile::FlushView(char* apData) noexcept
+{
+    msync(apData, _segmentSize, MS_ASYNC);
+}
+
+void MappedFile::SyncFile() noexcept
+{
+#ifdef __linux__
+    fdatasync(_file);
+#else
+    fsync(_file);
+#endif
+}
+
+void MappedFile::UnmapView(char* apData) noexcept
+{
+    munmap(apData, _segmentSize);
+}
+
+void MappedFile::CloseFile(uint64_t aSize) noexcept
+{
+    // If it fails there is nothing else to do, the file keeps its zero filled tail
+    [[maybe_unused]] const int result = ftruncate(_file, static_cast<off_t>(aSize));
+
+    close(_file);
+    _file = -1;
+}
+
+#endif
@@ -0,0 +1,83 @@
+#pragma once
+#include "MooDefaults.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+namespace moo {
+    // Append-only file written through memory mappings, meant for log files.
+    // The file is grown in large segments which are mapped one at a time, and each Write reserves its range
+    // by atomically advancing the write cursor and then copies straight into the mapping, so concurrent writers
+    // only meet on the cursor. A segment is unmapped by the writer that completes it.
+    // Close (or the destructor) truncates the file to what was actually written. If the process dies before that,
+    // the file keeps the zero filled tail of the last segment.
+    //
+    // Like an ofstream, failing to open leaves it closed (is_open() is false) and Write does nothing.
+    // Failing to grow or map the file later on throws a std::system_error.
+    class MappedFile {
+    public:
+        static constexpr size_t cDefaultSegmentSize = 64 * 1024 * 1024;
+
+        MappedFile(const std::string& aPath, bool aAppend = false, size_t aSegmentSize = cDefaultSegmentSize);
+        ~MappedFile();
+        MOO_DELETE_DEFAULTS(MappedFile);
+
+        [[nodiscard]] bool is_open() const noexcept;
+        [[nodiscard]] uint64_t Size() const noexcept;
+
+        void Write(std::string_view aData);
+
+        // Asks the OS to start writing the mapped pages back to the file, without waiting for it
+        void Flush();
+        // Writes everything written so far to the disk and waits for it (fdatasync / FlushFileBuffers)
+        void Sync();
+        void Close() noexcept;
+
+        // Flush every time this many bytes are written, 0 (the default) leaves it to the OS
+        void SyncEvery(uint64_t aBytes) noexcept;
+
+    private:
+        // Segment index k maps the file range [k * _segmentSize, (k + 1) * _segmentSize)
+        // Slot s holds the segments s, s + cSlotCount, s + 2 * cSlotCount... in that order
+        struct Slot {
+            std::atomic<uint64_t> _index = cNoSegment;
+            uint64_t _next = 0;
+            char* _pData = nullptr;
+            std::atomic<size_t> _written = 0;
+        };
+
+        static constexpr uint64_t cNoSegment = UINT64_MAX;
+        // A segment only needs its slot back after all the writes into it finished, so a few slots are plenty
+        static constexpr size_t cSlotCount = 4;
+
+        char* SegmentData(uint64_t aIndex);
+        char* MapSegment(uint64_t aIndex);
+        void Written(uint64_t aIndex, size_t aSize);
+
+        bool OpenFile(const std::string& aPath, bool aAppend) noexcept;
+        void GrowFile(uint64_t aSize);
+        char* MapView(uint64_t aOffset);
+        void FlushView(char* apData) noexcept;
+        void SyncFile() noexcept;
+        void UnmapView(char* apData) noexcept;
+        void CloseFile(uint64_t aSize) noexcept;
+
+#ifdef _WIN32
+        void* _file = nullptr;
+#else
+        int _file = -1;
+#endif
+        const size_t _segmentSize;
+        uint64_t _startOffset = 0;
+        uint64_t _fileSize = 0;
+        std::atomic<uint64_t> _syncEvery = 0;
+
+        std::atomic<uint64_t> _cursor = 0;
+        std::array<Slot, cSlotCount> _slots;
+        std::mutex _mapMutex;
+    };
+}
@@ -1,4 +1,7 @@
 #pragma once
+
+#ifdef _MSC_VER
+
 #include <corecrt.h>
 
 _CRT_BEGIN_C_HEADER
@@ -24,6 +27,18 @@ _ACRTIMP void __cdecl _wassert(
 
 _CRT_END_C_HEADER
 
+#else
+
+#include <cassert>
+
+#ifdef NDEBUG
+#define MOO_ASSERT(expression) ((void)(expression))
+#else
+#define MOO_ASSERT(expression) assert(expression)
+#endif
+
+#endif // _MSC_VER
+
 //----------------------------------------------------------------------------------------------------------------------
 
 #define MOO_ASSERT_RETURN(arg, ...) \
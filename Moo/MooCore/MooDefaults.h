@@ -17,3 +17,10 @@ Class(const Class&) = default;\
 Class& operator=(const Class&) = default;\
 Class(Class&&) = default;\
 Class& operator=(Class&&) = default
+
+// MSVC only honors [[no_unique_address]] in its own spelling
+#ifdef _MSC_VER
+#define MOO_NO_UNIQUE_ADDRESS [[msvc::no_unique_address]]
+#else
+#define MOO_NO_UNIQUE_ADDRESS [[no_unique_address]]
+#endif
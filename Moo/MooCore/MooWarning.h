@@ -4,6 +4,8 @@
 
 #define MOO_STRINGIFY(x) #x
 
+#ifdef _MSC_VER
+
 #define MOO_SUPPRESS(x) _Pragma(MOO_STRINGIFY(warning(suppress:##x)))
 #define MOO_DISABLE(x) _Pragma(MOO_STRINGIFY(warning(disable:##x)))
 #define MOO_WARNING_PUSH _Pragma("warning(push)")
@@ -15,6 +17,23 @@
 // 26477: Use 'nullptr' rather than 0 or NULL
 #define MOO_VERIFY(A_COND, A_MSG) MOO_SUPPRESS(26477) _STL_VERIFY(A_COND, A_MSG)
 
+#else
+
+#include <cassert>
+
+// The warning numbers are MSVC's, and other compilers have no checked iterators to match
+#define MOO_SUPPRESS(x)
+#define MOO_DISABLE(x)
+#define MOO_WARNING_PUSH
+#define MOO_WARNING_POP
+
+#define MOO_ITERATOR_DEBUG_LEVEL 0
+#define MOO_CONTAINER_DEBUG_LEVEL 0
+
+#define MOO_VERIFY(A_COND, A_MSG) assert((A_COND) && A_MSG)
+
+#endif // _MSC_VER
+
 #if MOO_CONTAINER_DEBUG_LEVEL > 0
     #define MOO_VERIFY_INDEX(A_INDEX, A_SIZE) MOO_VERIFY(A_INDEX < A_SIZE, "index out of range")
 #else
@@ -0,0 +1,149 @@
+#pragma once
+
+#include "MooDefaults.h"
+#include "ScopedArray.hpp"
+
+#include <atomic>
+
+namespace moo {
+    // Bounded lock-free multi-producer multi-consumer ring buffer.
+    // Every cell carries a sequence number that tells whether it is free for the producer that claimed its position
+    // or holds a value ready for a consumer (Dmitry Vyukov's bounded queue). Producers and consumers claim positions
+    // with a CAS, so a full ring makes TryPush fail instead of blocking; what to do then is up to the caller,
+    // e.g. popping the oldest value to make room.
+    // The capacity is rounded up to a power of two.
+    template<class T>
+    class MpmcRing {
+    public:
+        explicit MpmcRing(size_t aCapacity);
+        MOO_DELETE_DEFAULTS(MpmcRing);
+
+        // aValue is only moved from when it was pushed
+        [[nodiscard]] bool TryPush(T&& aValue) noexcept(std::is_nothrow_move_assignable_v<T>);
+        [[nodiscard]] bool TryPop(T& aValue) noexcept(std::is_nothrow_move_assignable_v<T>);
+
+        [[nodiscard]] bool Empty() const noexcept;
+        [[nodiscard]] size_t Capacity() const noexcept;
+
+    private:
+        struct Cell {
+            std::atomic<size_t> _sequence;
+            T _value;
+        };
+
+        static constexpr size_t cCacheLine = 64;
+
+        static size_t RoundUpCapacity(size_t aCapacity) noexcept;
+
+        ScopedArray<Cell> _cells;
+        const size_t _mask;
+
+        alignas(cCacheLine) std::atomic<size_t> _enqueuePos = 0;
+        alignas(cCacheLine) std::atomic<size_t> _dequeuePos = 0;
+    };
+}
+
+template<class T>
+moo::MpmcRing<T>::MpmcRing(size_t aCapacity)
+    : _cells(RoundUpCapacity(aCapacity))
+    , _mask(_cells.size() - 1)
+{
+    for (size_t i = 0; i < _cells.size(); ++i)
+    {
+        _cells[i]._sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+template<class T>
+[[nodiscard]] bool moo::MpmcRing<T>::TryPush(T&& aValue) noexcept(std::is_nothrow_move_assignable_v<T>)
+{
+    using namespace std;
+
+    size_t pos = _enqueuePos.load(memory_order_relaxed);
+
+    for (;;)
+    {
+        Cell& cell = _cells[pos & _mask];
+        const size_t sequence = cell._sequence.load(memory_order_acquire);
+        const ptrdiff_t diff = static_cast<ptrdiff_t>(sequence) - static_cast<ptrdiff_t>(pos);
+
+        if (diff == 0)
+        {
+            if (_enqueuePos.compare_exchange_weak(pos, pos + 1))
+            {
+                cell._value = move(aValue);
+                cell._sequence.store(pos + 1, memory_order_release);
+                return true;
+            }
+        }
+        else if (diff < 0)
+        {
+            return false; // full
+        }
+        else
+        {
+            pos = _enqueuePos.load(memory_order_relaxed);
+        }
+    }
+}
+
+template<class T>
+[[nodiscard]] bool moo::MpmcRing<T>::TryPop(T& aValue) noexcept(std::is_nothrow_move_assignable_v<T>)
+{
+    using namespace std;
+
+    size_t pos = _dequeuePos.load(memory_order_relaxed);
+
+    for (;;)
+    {
+        Cell& cell = _cells[pos & _mask];
+        const size_t sequence = cell._sequence.load(memory_order_acquire);
+        const ptrdiff_t diff = static_cast<ptrdiff_t>(sequence) - static_cast<ptrdiff_t>(pos + 1);
+
+        if (diff == 0)
+        {
+            if (_dequeuePos.compare_exchange_weak(pos, pos + 1))
+            {
+                aValue = move(cell._value);
+                cell._sequence.store(pos + _mask + 1, memory_order_release);
+                return true;
+            }
+        }
+        else if (diff < 0)
+        {
+            return false; // empty, or the producer of this cell has not finished yet
+        }
+        else
+        {
+            pos = _dequeuePos.load(memory_order_relaxed);
+        }
+    }
+}
+
+template<class T>
+[[nodiscard]] bool moo::MpmcRing<T>::Empty() const noexcept
+{
+    return _enqueuePos.load() == _dequeuePos.load();
+}
+
+template<class T>
+[[nodiscard]] size_t moo::MpmcRing<T>::Capacity() const noexcept
+{
+    return _cells.size();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// private:
+
+template<class T>
+size_t moo::MpmcRing<T>::RoundUpCapacity(size_t aCapacity) noexcept
+{
+    size_t capacity = 2;
+
+    while (capacity < aCapacity)
+    {
+        capacity *= 2;
+    }
+
+    return capacity;
+}
@@ -1,9 +1,12 @@
 #pragma once
+#include "Concepts.h"
 #include "MooAssert.h"
 #include "Where.h"
 
+#include "FlightRecorder.h"
 #include "Logger.h"
 
+#include <functional>
 #include <iostream>
 #include <optional>
 
@@ -93,6 +96,12 @@ namespace moo {
 
         {
             Logger::Lock lock;
+            // What led up to it comes before the error
+            if (FlightRecorder::On())
+            {
+                Logger::DumpFlightRecorder(errorMessage);
+            }
+
             aWhere.Print(cerr_noExcept, std::endl);
             cerr_noExcept << errorMessage << std::endl;
         }
@@ -1,16 +1,27 @@
 #pragma once
 
-#include "ScopedArray.hpp"
+#include "ArenaStreamBuf.h"
+#include "InlineArray.hpp"
 #include "MooDefaults.h"
 #include "NoExcept.hpp"
 
-#include <sstream>
+#include <ostream>
 
+#include <atomic>
 #include <functional>
+#include <span>
+#include <string_view>
+#include <unordered_map>
 
 namespace moo {
+    // What a RedirectStream hands each record to, at endl/flush.
+    // A target that takes a std::string_view or a std::span<const char> gets a view of the stream's own buffer,
+    // valid only during the call, so the record isn't copied unless the target copies it.
+    // It must not write to the stream it was called for.
     template<class T>
-    concept RedirectStreamTarget = std::invocable<T, std::string>;
+    concept RedirectStreamTarget = std::invocable<T, std::string>
+        || std::invocable<T, std::string_view>
+        || std::invocable<T, std::span<const char>>;
 
     template<class T>
     concept NotRedirectStreamTarget = !RedirectStreamTarget<T>;
@@ -24,8 +35,21 @@ namespace moo {
 
     using StreamList = std::initializer_list<std::ostream*>;
 
+    // The per-thread buffers of every RedirectStream in ThreadLocalBuffers mode, keyed by a unique id of the stream.
+    // A thread keeps its buffers, and their memory, from one record to the next. Once it has cMaxBuffers, the empty
+    // ones are dropped when it starts writing to a new stream, so buffers of streams that are gone don't pile up.
+    class ThreadBuffers {
+    public:
+        static constexpr size_t cMaxBuffers = 8;
+
+        [[nodiscard]] static ArenaStreamBuf& Get(uint64_t aStreamId);
+        [[nodiscard]] static uint64_t NewStreamId() noexcept;
+    };
+
+    // Collects what is written to the redirected streams in an ArenaStreamBuf (one per thread with
+    // ThreadLocalBuffers), and hands it to the target as one record at every endl/flush.
     template<RedirectStreamTarget T>
-    class RedirectStream : private std::stringbuf, public std::ostream {
+    class RedirectStream : private ArenaStreamBuf, public std::ostream {
     public:
         RedirectStream(StreamList aOSPtrs, T&& aTarget);
 
@@ -42,13 +66,36 @@ namespace moo {
 
         MOO_DELETE_DEFAULTS(RedirectStream);
 
+        // Gives each thread its own buffer, so threads can format concurrently and only the call to the target,
+        // once per endl/flush, has to be serialized (by the target).
+        // The redirected streams are untied and lose unitbuf (cerr has it) until they are restored, otherwise
+        // every insertion would flush the partial line.
+        // The formatting state (width, precision, flags) of the redirected streams is still shared.
+        // Call it before anything is written to the stream.
+        void ThreadLocalBuffers(bool aThreadLocal) noexcept;
+
+        // Gives the streams their own buffers back, like the destructor, for when that has to happen
+        // under a lock the rest of the destruction can't hold
+        void Restore() noexcept;
+
     private:
+        using int_type = ArenaStreamBuf::int_type;
+        using traits_type = ArenaStreamBuf::traits_type;
+
         int sync() noexcept override;
+        std::streamsize xsputn(const char* apStr, std::streamsize aCount) override;
+        int_type overflow(int_type aChar) override;
+
+        // Calls the target with the kind of argument it takes
+        void Write(std::string_view aRecord);
 
         struct StreamPtrs;
 
         T _target;
-        ScopedArray<StreamPtrs> _streamPtrs;
+        // Almost always one to three streams
+        InlineArray<StreamPtrs, 3> _streamPtrs;
+        const uint64_t _id = ThreadBuffers::NewStreamId();
+        bool _threadLocal = false;
     };
 }
 
@@ -67,21 +114,129 @@ moo::RedirectStream<T>::RedirectStream(StreamList aOSPtrs, T&& aTarget)
     }
 }
 
+template<moo::RedirectStreamTarget T>
+void moo::RedirectStream<T>::ThreadLocalBuffers(bool aThreadLocal) noexcept
+{
+    _threadLocal = aThreadLocal;
+
+    // Without a put area every write goes through xsputn/overflow, which pick the thread's buffer
+    if (_threadLocal)
+    {
+        setp(nullptr, nullptr);
+    }
+    else
+    {
+        Clear();
+    }
+
+    for (StreamPtrs& streamPtrs : _streamPtrs)
+    {
+        streamPtrs._pOS->tie(_threadLocal ? nullptr : this);
+
+        if (_threadLocal)
+        {
+            streamPtrs._pOS->unsetf(std::ios::unitbuf);
+        }
+        else if (streamPtrs._oldUnitBuf)
+        {
+            streamPtrs._pOS->setf(std::ios::unitbuf);
+        }
+    }
+}
+
+template<moo::RedirectStreamTarget T>
+void moo::RedirectStream<T>::Restore() noexcept
+{
+    _streamPtrs.reset();
+}
+
 template<moo::RedirectStreamTarget T>
 int moo::RedirectStream<T>::sync() noexcept
 {
     return NoExceptSuccess([&]()
         {
-            std::string myStr = str();
-            if (myStr != "")
+            ArenaStreamBuf& buffer = _threadLocal ? ThreadBuffers::Get(_id) : *this;
+
+            if (!buffer.Empty())
             {
-                _target(myStr);
-                str("");
+                Write(buffer.View());
+                buffer.Clear();
             }
         }
         , MOO_WHERE) ? 0 : -1;
 }
 
+template<moo::RedirectStreamTarget T>
+std::streamsize moo::RedirectStream<T>::xsputn(const char* apStr, std::streamsize aCount)
+{
+    if (!_threadLocal)
+    {
+        return ArenaStreamBuf::xsputn(apStr, aCount);
+    }
+
+    return ThreadBuffers::Get(_id).sputn(apStr, aCount);
+}
+
+template<moo::RedirectStreamTarget T>
+typename moo::RedirectStream<T>::int_type moo::RedirectStream<T>::overflow(int_type aChar)
+{
+    if (!_threadLocal)
+    {
+        return ArenaStreamBuf::overflow(aChar);
+    }
+
+    // Our own put area stays unused in this mode, so every single character comes here too
+    if (!traits_type::eq_int_type(aChar, traits_type::eof()))
+    {
+        ThreadBuffers::Get(_id).sputc(traits_type::to_char_type(aChar));
+    }
+
+    return traits_type::not_eof(aChar);
+}
+
+template<moo::RedirectStreamTarget T>
+void moo::RedirectStream<T>::Write(std::string_view aRecord)
+{
+    if constexpr (std::invocable<T&, std::string_view>)
+    {
+        _target(aRecord);
+    }
+    else if constexpr (std::invocable<T&, std::span<const char>>)
+    {
+        _target(std::span<const char>(aRecord.data(), aRecord.size()));
+    }
+    else
+    {
+        _target(std::string(aRecord));
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+inline moo::ArenaStreamBuf& moo::ThreadBuffers::Get(uint64_t aStreamId)
+{
+    // Node based, so a buffer stays put while other streams of the same thread are flushed into their targets
+    thread_local std::unordered_map<uint64_t, ArenaStreamBuf> tl_buffers;
+
+    if (auto it = tl_buffers.find(aStreamId); it != tl_buffers.end())
+    {
+        return it->second;
+    }
+
+    if (tl_buffers.size() >= cMaxBuffers)
+    {
+        std::erase_if(tl_buffers, [](const auto& aItem) { return aItem.second.Empty(); });
+    }
+
+    return tl_buffers.try_emplace(aStreamId).first->second;
+}
+
+inline uint64_t moo::ThreadBuffers::NewStreamId() noexcept
+{
+    static std::atomic<uint64_t> s_nextId = 0;
+    return s_nextId++;
+}
+
 //----------------------------------------------------------------------------------------------------------------------
 
 template<moo::RedirectStreamTarget T>
@@ -97,6 +252,7 @@ struct moo::RedirectStream<T>::StreamPtrs {
     std::ostream* _pOS = nullptr;
     std::streambuf* _pOldBuf = nullptr;
     std::ostream* _pOldTie = nullptr;
+    bool _oldUnitBuf = false;
 };
 
 template<moo::RedirectStreamTarget T>
@@ -104,6 +260,7 @@ moo::RedirectStream<T>::StreamPtrs::StreamPtrs(std::ostream* apOS) noexcept
     : _pOS(apOS)
     , _pOldBuf(apOS->rdbuf())
     , _pOldTie(apOS->tie())
+    , _oldUnitBuf((apOS->flags() & std::ios::unitbuf) != 0)
 {
     MOO_ASSERT_NOT_NULL(apOS);
 }
@@ -117,6 +274,11 @@ moo::RedirectStream<T>::StreamPtrs::~StreamPtrs()
             {
                 _pOS->rdbuf(_pOldBuf);
                 _pOS->tie(_pOldTie);
+
+                if (_oldUnitBuf)
+                {
+                    _pOS->setf(std::ios::unitbuf);
+                }
             }, MOO_WHERE);
     }
 }
@@ -124,7 +286,7 @@ moo::RedirectStream<T>::StreamPtrs::~StreamPtrs()
 template<moo::RedirectStreamTarget T>
 moo::RedirectStream<T>::StreamPtrs::StreamPtrs(StreamPtrs&& aOther) noexcept
 {
-    *this = move(aOther);
+    *this = std::move(aOther);
 }
 
 template<moo::RedirectStreamTarget T>
@@ -134,6 +296,7 @@ moo::RedirectStream<T>::StreamPtrs&
     _pOS = aOther._pOS;
     _pOldBuf = aOther._pOldBuf;
     _pOldTie = aOther._pOldTie;
+    _oldUnitBuf = aOther._oldUnitBuf;
 
     aOther._pOS = nullptr;
     aOther._pOldBuf = nullptr;
@@ -0,0 +1,91 @@
+#pragma once
+#include "MooDefaults.h"
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+namespace moo {
+    // The running instance of a logger, for the threads that write to it without taking a lock.
+    // A thread gets it through a Use, which keeps it alive: Stop clears it and then waits until no Use holds it,
+    // so the owner can destroy it right after. Stop must not be called while holding a lock a Use may wait for.
+    template<class T>
+    class RunningInstance {
+    public:
+        class Use {
+        public:
+            explicit Use(RunningInstance& aRunning) noexcept;
+            ~Use();
+            MOO_DELETE_DEFAULTS(Use);
+
+            // Null when none is running
+            [[nodiscard]] T* get() const noexcept { return _pInstance; }
+            T* operator->() const noexcept { return _pInstance; }
+            explicit operator bool() const noexcept { return _pInstance != nullptr; }
+
+        private:
+            RunningInstance& _running;
+            T* _pInstance;
+        };
+
+        RunningInstance() noexcept = default;
+        MOO_DELETE_DEFAULTS(RunningInstance);
+
+        // Fails when another instance is running
+        bool Start(T* apInstance) noexcept;
+        // Does nothing when apInstance isn't the running one
+        void Stop(T* apInstance) noexcept;
+
+        [[nodiscard]] bool Running() const noexcept;
+
+    private:
+        std::atomic<T*> _pInstance = nullptr;
+        std::atomic<uint32_t> _users = 0;
+    };
+}
+
+template<class T>
+moo::RunningInstance<T>::Use::Use(RunningInstance& aRunning) noexcept
+    : _running(aRunning)
+{
+    // Counted before the instance is loaded, and Stop clears the instance before it reads the count,
+    // so either Stop sees this Use or this Use sees no instance
+    _running._users.fetch_add(1);
+    _pInstance = _running._pInstance.load();
+}
+
+template<class T>
+moo::RunningInstance<T>::Use::~Use()
+{
+    _running._users.fetch_sub(1, std::memory_order_release);
+}
+
+template<class T>
+bool moo::RunningInstance<T>::Start(T* apInstance) noexcept
+{
+    T* pExpected = nullptr;
+    return _pInstance.compare_exchange_strong(pExpected, apInstance);
+}
+
+template<class T>
+void moo::RunningInstance<T>::Stop(T* apInstance) noexcept
+{
+    T* pExpected = apInstance;
+
+    if (!_pInstance.compare_exchange_strong(pExpected, nullptr))
+    {
+        return;
+    }
+
+    // A Use only lasts one write, so it's short unless the write waits for room in a queue
+    while (_users.load() != 0)
+    {
+        std::this_thread::yield();
+    }
+}
+
+template<class T>
+[[nodiscard]] bool moo::RunningInstance<T>::Running() const noexcept
+{
+    return _pInstance.load(std::memory_order_relaxed) != nullptr;
+}
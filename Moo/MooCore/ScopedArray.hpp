@@ -3,30 +3,93 @@
 #define MOO_EXCLUDE_IOS_INCLUDES
 
 #include "Concepts.h"
+#include "MooAssert.h"
 #include "MooDefaults.h"
 #include "MooWarning.h"
 
+#include <concepts>
+#include <cstring>
 #include <memory>
+#include <ranges>
 #include <span>
+#include <utility>
 
 namespace moo {
+#ifdef _MSC_VER
+    // The checked iterator of std::span
     template<class T>
+    using SpanIterator = std::_Span_iterator<T>;
+#else
+    template<class T>
+    using SpanIterator = T*;
+#endif
+
+    // Tags the constructor and Reset that default-initialize the elements, which leaves trivial types uninitialized,
+    // for buffers that are filled right after
+    struct ForOverwrite {
+        explicit ForOverwrite() = default;
+    };
+    inline constexpr ForOverwrite cForOverwrite{};
+
+    // Tags the Reset that takes memory the allocator of the ScopedArray allocated, with its elements constructed
+    struct FromAllocator {
+        explicit FromAllocator() = default;
+    };
+    inline constexpr FromAllocator cFromAllocator{};
+
+    // A range ScopedArray can be constructed and assigned from: anything sized that isn't a ScopedArray,
+    // which can't be copied, with elements T can be constructed from
+    template<class TArray, class T, class Range>
+    concept AssignableRange = ConstructibleFromRangeElement<T, Range> && std::ranges::sized_range<Range>
+        && !std::same_as<std::remove_cvref_t<Range>, TArray>;
+
+    // Assigns the elements of aRange to as many elements at apData, the way ScopedArray::operator= describes
+    template<class T, class Range>
+    void AssignRangeElements(T* apData, Range&& aRange);
+    // Constructs the elements of aRange in as much uninitialized memory at apData
+    template<class T, class Range>
+    void ConstructRangeElements(T* apData, Range&& aRange);
+
+    // The default deleter of ScopedArray: the elements are destroyed and freed with its allocator
+    struct AllocatorDelete {};
+
+    // The elements are allocated and freed with TAllocator.
+    // Like the deleter of a unique_ptr, another TDeleter frees memory the allocator didn't allocate, e.g. of an
+    // arena or a pool, or std::default_delete<T[]> for new[]. It gets the data and the size, or only the data.
+    // Such an array doesn't allocate: it only holds what is handed over to Reset(T*, ...). The default array only
+    // takes memory of its allocator, tagged with cFromAllocator.
+    // The allocator and the deleter move along with the elements, and take no room when they are stateless.
+    template<class T, class TAllocator = std::allocator<T>, class TDeleter = AllocatorDelete>
     struct ScopedArray {
         using Type = T;
-        using Iterator = std::_Span_iterator<T>;
-        using ConstIterator = std::_Span_iterator<const T>;
+        using Allocator = TAllocator;
+        using Deleter = TDeleter;
+        using Iterator = SpanIterator<T>;
+        using ConstIterator = SpanIterator<const T>;
 
-        std::unique_ptr<T[]> _data;
+        static constexpr bool cAllocates = std::same_as<TDeleter, AllocatorDelete>;
+
+        T* _data = nullptr;
         size_t _size = 0;
 
         ScopedArray() = default;
-        ~ScopedArray() = default;
-        explicit constexpr ScopedArray(size_t aSize);
-        template<class Range> requires ConstructibleFromRangeElement<T, Range>
-        explicit constexpr ScopedArray(Range aRange);
-        template<class Range> requires ConstructibleFromRangeElement<T, Range>
-        ScopedArray& operator=(Range aRange);
-        MOO_NO_COPY(ScopedArray);
+        ~ScopedArray();
+        explicit ScopedArray(const TAllocator& aAllocator) noexcept;
+        explicit ScopedArray(TDeleter aDeleter) noexcept requires (!cAllocates);
+        explicit constexpr ScopedArray(size_t aSize, const TAllocator& aAllocator = TAllocator());
+        constexpr ScopedArray(size_t aSize, ForOverwrite, const TAllocator& aAllocator = TAllocator());
+        template<class Range> requires AssignableRange<ScopedArray, T, Range>
+        explicit constexpr ScopedArray(Range&& aRange);
+        // Reuses the elements when the size is the same, and otherwise constructs the new ones in place.
+        // Trivially copyable elements of a contiguous range are copied with memcpy.
+        // The elements of a range that owns them and is an rvalue are moved from, the others are copied.
+        template<class Range> requires AssignableRange<ScopedArray, T, Range>
+        ScopedArray& operator=(Range&& aRange);
+
+        ScopedArray(ScopedArray&& aOther) noexcept;
+        ScopedArray& operator=(ScopedArray&& aOther) noexcept;
+        ScopedArray(const ScopedArray&) = delete;
+        ScopedArray& operator=(const ScopedArray&) = delete;
 
         [[nodiscard]] constexpr Iterator begin() noexcept { return begin<T>(this); }
         [[nodiscard]] constexpr ConstIterator begin() const noexcept { return begin<const T>(this); }
@@ -43,126 +106,341 @@ namespace moo {
         [[nodiscard]] constexpr const T* data() const noexcept;
 
         constexpr void reset() noexcept;
+        // Value-initializes the elements
         constexpr void Reset(size_t aSize = 0);
-        // Warning! Always make sure apData was allocated using 'new[]' like so:
-        //   apData = new T[aSize]
+        constexpr void Reset(size_t aSize, ForOverwrite);
+        // Takes apData, which the deleter frees when the array is reset or destroyed.
+        // It doesn't compile for the default deleter: memory from 'new T[aSize]' needs std::default_delete<T[]>.
         constexpr void Reset(T* apData, size_t aSize = 0) noexcept;
+        // Also replaces the deleter, for a stateful one
+        void Reset(T* apData, size_t aSize, TDeleter aDeleter) noexcept requires (!cAllocates);
+        // Takes apData, which the allocator allocated, with the default deleter
+        constexpr void Reset(T* apData, size_t aSize, FromAllocator) noexcept;
 
         [[nodiscard]] constexpr std::span<const char> CBytes() const noexcept;
         [[nodiscard]] constexpr std::span<const unsigned char> CUBytes() const noexcept;
 
     private:
+        // Replaces the elements with aSize new ones, which aConstruct(T* apData) constructs
+        template<class Construct>
+        void Allocate(size_t aSize, Construct&& aConstruct);
+        // Frees the elements and takes apData instead
+        constexpr void Adopt(T* apData, size_t aSize) noexcept;
+        // Frees the elements, leaving the array empty
+        void Release() noexcept;
 
         template<class Tv, class TSelf>
-        [[nodiscard]] static inline constexpr std::_Span_iterator<Tv> begin(TSelf* apSelf) noexcept;
+        [[nodiscard]] static constexpr SpanIterator<Tv> begin(TSelf* apSelf) noexcept;
         template<class Tv, class TSelf>
-        [[nodiscard]] static inline constexpr std::_Span_iterator<Tv> end(TSelf* apSelf) noexcept;
+        [[nodiscard]] static constexpr SpanIterator<Tv> end(TSelf* apSelf) noexcept;
+
+        MOO_NO_UNIQUE_ADDRESS TAllocator _allocator;
+        MOO_NO_UNIQUE_ADDRESS TDeleter _deleter;
     };
 }
 
-template<class T>
-constexpr moo::ScopedArray<T>::ScopedArray(size_t aSize)
-    : _data(std::make_unique<T[]>(aSize))
-    , _size(aSize)
+namespace moo {
+    // The elements of a contiguous range of trivially copyable T are copied with memcpy
+    template<class T, class Range>
+    constexpr bool cCopyRangeBytes = std::ranges::contiguous_range<Range> && std::is_trivially_copyable_v<T>
+        && std::same_as<std::remove_cvref_t<std::ranges::range_reference_t<Range>>, T>;
+
+    // The elements of a range that owns them and is an rvalue are moved from
+    template<class Range>
+    constexpr bool cMoveRangeElements = !std::is_lvalue_reference_v<Range> && !std::ranges::borrowed_range<Range>;
+}
+
+template<class T, class Range>
+void moo::AssignRangeElements(T* apData, Range&& aRange)
+{
+    if constexpr (cCopyRangeBytes<T, Range>)
+    {
+        const size_t size = static_cast<size_t>(std::ranges::size(aRange));
+
+        // Assigning an array to itself leaves nothing to do
+        if (size != 0 && std::ranges::data(aRange) != apData)
+        {
+            std::memcpy(apData, std::ranges::data(aRange), size * sizeof(T));
+        }
+    }
+    else
+    {
+        T* pItem = apData;
+        for (auto&& item : aRange)
+        {
+            if constexpr (cMoveRangeElements<Range>)
+            {
+                *pItem = T(std::move(item));
+            }
+            else
+            {
+                *pItem = T(item);
+            }
+
+            ++pItem;
+        }
+    }
+}
+
+template<class T, class Range>
+void moo::ConstructRangeElements(T* apData, Range&& aRange)
+{
+    const size_t size = static_cast<size_t>(std::ranges::size(aRange));
+
+    if constexpr (cCopyRangeBytes<T, Range>)
+    {
+        if (size != 0)
+        {
+            std::memcpy(apData, std::ranges::data(aRange), size * sizeof(T));
+        }
+    }
+    else if constexpr (cMoveRangeElements<Range>)
+    {
+        std::ranges::uninitialized_move(aRange, std::span(apData, size));
+    }
+    else
+    {
+        std::ranges::uninitialized_copy(aRange, std::span(apData, size));
+    }
+}
+
+template<class T, class TAllocator, class TDeleter>
+moo::ScopedArray<T, TAllocator, TDeleter>::~ScopedArray()
+{
+    Release();
+}
+
+template<class T, class TAllocator, class TDeleter>
+moo::ScopedArray<T, TAllocator, TDeleter>::ScopedArray(const TAllocator& aAllocator) noexcept
+    : _allocator(aAllocator)
+{}
+
+template<class T, class TAllocator, class TDeleter>
+moo::ScopedArray<T, TAllocator, TDeleter>::ScopedArray(TDeleter aDeleter) noexcept requires (!cAllocates)
+    : _deleter(std::move(aDeleter))
 {}
 
-template<class T>
+template<class T, class TAllocator, class TDeleter>
+constexpr moo::ScopedArray<T, TAllocator, TDeleter>::ScopedArray(size_t aSize, const TAllocator& aAllocator)
+    : _allocator(aAllocator)
+{
+    Reset(aSize);
+}
+
+template<class T, class TAllocator, class TDeleter>
+constexpr moo::ScopedArray<T, TAllocator, TDeleter>::ScopedArray(size_t aSize, ForOverwrite,
+    const TAllocator& aAllocator)
+    : _allocator(aAllocator)
+{
+    Reset(aSize, cForOverwrite);
+}
+
+template<class T, class TAllocator, class TDeleter>
 template<class Range>
-    requires moo::ConstructibleFromRangeElement<T, Range>
-constexpr moo::ScopedArray<T>::ScopedArray(Range aRange)
+    requires moo::AssignableRange<moo::ScopedArray<T, TAllocator, TDeleter>, T, Range>
+constexpr moo::ScopedArray<T, TAllocator, TDeleter>::ScopedArray(Range&& aRange)
 {
-    *this = aRange;
+    *this = std::forward<Range>(aRange);
 }
 
-template<class T>
+template<class T, class TAllocator, class TDeleter>
 template<class Range>
-    requires moo::ConstructibleFromRangeElement<T, Range>
-moo::ScopedArray<T>& moo::ScopedArray<T>::operator=(Range aRange)
+    requires moo::AssignableRange<moo::ScopedArray<T, TAllocator, TDeleter>, T, Range>
+moo::ScopedArray<T, TAllocator, TDeleter>& moo::ScopedArray<T, TAllocator, TDeleter>::operator=(Range&& aRange)
 {
-    Reset(aRange.size());
+    const size_t size = static_cast<size_t>(std::ranges::size(aRange));
 
-    auto itData = begin();
-    for (auto& item : aRange)
+    if (size == _size)
     {
-        *itData = T(std::move(item));
-        ++itData;
+        AssignRangeElements(_data, std::forward<Range>(aRange));
+    }
+    else
+    {
+        Allocate(size, [&](T* apData) { ConstructRangeElements(apData, std::forward<Range>(aRange)); });
     }
 
     return *this;
 }
 
-template<class T>
-[[nodiscard]] constexpr T& moo::ScopedArray<T>::operator[](size_t aIndex) noexcept
+template<class T, class TAllocator, class TDeleter>
+moo::ScopedArray<T, TAllocator, TDeleter>::ScopedArray(ScopedArray&& aOther) noexcept
+    : _data(std::exchange(aOther._data, nullptr))
+    , _size(std::exchange(aOther._size, 0))
+    , _allocator(std::move(aOther._allocator))
+    , _deleter(std::move(aOther._deleter))
+{
+}
+
+template<class T, class TAllocator, class TDeleter>
+moo::ScopedArray<T, TAllocator, TDeleter>&
+    moo::ScopedArray<T, TAllocator, TDeleter>::operator=(ScopedArray&& aOther) noexcept
+{
+    if (this != &aOther)
+    {
+        Release();
+
+        _data = std::exchange(aOther._data, nullptr);
+        _size = std::exchange(aOther._size, 0);
+        _allocator = std::move(aOther._allocator);
+        _deleter = std::move(aOther._deleter);
+    }
+
+    return *this;
+}
+
+template<class T, class TAllocator, class TDeleter>
+[[nodiscard]] constexpr T& moo::ScopedArray<T, TAllocator, TDeleter>::operator[](size_t aIndex) noexcept
 {
     MOO_RETURN_RANDOM_ACCESS(data(), aIndex, _size);
 }
-template<class T>
-[[nodiscard]] constexpr const T& moo::ScopedArray<T>::operator[](size_t aIndex) const noexcept
+template<class T, class TAllocator, class TDeleter>
+[[nodiscard]] constexpr const T& moo::ScopedArray<T, TAllocator, TDeleter>::operator[](size_t aIndex) const noexcept
 {
     MOO_RETURN_RANDOM_ACCESS(data(), aIndex, _size);
 }
 
-template<class T>
-[[nodiscard]] constexpr size_t moo::ScopedArray<T>::size() const noexcept
+template<class T, class TAllocator, class TDeleter>
+[[nodiscard]] constexpr size_t moo::ScopedArray<T, TAllocator, TDeleter>::size() const noexcept
 {
     return _size;
 }
 
-template<class T>
-[[nodiscard]] constexpr T* moo::ScopedArray<T>::data() noexcept
+template<class T, class TAllocator, class TDeleter>
+[[nodiscard]] constexpr T* moo::ScopedArray<T, TAllocator, TDeleter>::data() noexcept
 {
-    return _data.get();
+    return _data;
 }
-template<class T>
-[[nodiscard]] constexpr const T* moo::ScopedArray<T>::data() const noexcept
+template<class T, class TAllocator, class TDeleter>
+[[nodiscard]] constexpr const T* moo::ScopedArray<T, TAllocator, TDeleter>::data() const noexcept
 {
-    return _data.get();
+    return _data;
 }
 
-template<class T>
-constexpr void moo::ScopedArray<T>::reset() noexcept
+template<class T, class TAllocator, class TDeleter>
+constexpr void moo::ScopedArray<T, TAllocator, TDeleter>::reset() noexcept
 {
-    Reset();
+    Release();
 }
-template<class T>
-constexpr void moo::ScopedArray<T>::Reset(size_t aSize)
+template<class T, class TAllocator, class TDeleter>
+constexpr void moo::ScopedArray<T, TAllocator, TDeleter>::Reset(size_t aSize)
 {
-    _size = aSize;
+    Allocate(aSize, [aSize](T* apData) { std::uninitialized_value_construct_n(apData, aSize); });
+}
+template<class T, class TAllocator, class TDeleter>
+constexpr void moo::ScopedArray<T, TAllocator, TDeleter>::Reset(size_t aSize, ForOverwrite)
+{
+    Allocate(aSize, [aSize](T* apData) { std::uninitialized_default_construct_n(apData, aSize); });
+}
+template<class T, class TAllocator, class TDeleter>
+constexpr void moo::ScopedArray<T, TAllocator, TDeleter>::Reset(T* apData, size_t aSize) noexcept
+{
+    // It used to take memory from new[], which the allocator can't free
+    static_assert(!cAllocates, "use std::default_delete<T[]> for memory from new[], or cFromAllocator");
+
+    Adopt(apData, aSize);
+}
+template<class T, class TAllocator, class TDeleter>
+void moo::ScopedArray<T, TAllocator, TDeleter>::Reset(T* apData, size_t aSize, TDeleter aDeleter) noexcept
+    requires (!cAllocates)
+{
+    Adopt(apData, aSize);
+    _deleter = std::move(aDeleter);
+}
+template<class T, class TAllocator, class TDeleter>
+constexpr void moo::ScopedArray<T, TAllocator, TDeleter>::Reset(T* apData, size_t aSize, FromAllocator) noexcept
+{
+    static_assert(cAllocates, "a ScopedArray with a deleter frees what it's handed over with the deleter");
+
+    Adopt(apData, aSize);
+}
+
+template<class T, class TAllocator, class TDeleter>
+[[nodiscard]] constexpr std::span<const char> moo::ScopedArray<T, TAllocator, TDeleter>::CBytes() const noexcept
+{
+    return { reinterpret_cast<const char*>(data()), _size * sizeof(T) };
+}
+template<class T, class TAllocator, class TDeleter>
+[[nodiscard]] constexpr std::span<const unsigned char>
+    moo::ScopedArray<T, TAllocator, TDeleter>::CUBytes() const noexcept
+{
+    return { reinterpret_cast<const unsigned char*>(data()), _size * sizeof(T) };
+}
+
+//-------------------------------------------------------------------------------------------------------
+// private:
+
+template<class T, class TAllocator, class TDeleter>
+template<class Construct>
+void moo::ScopedArray<T, TAllocator, TDeleter>::Allocate(size_t aSize, Construct&& aConstruct)
+{
+    static_assert(cAllocates, "a ScopedArray with a deleter only holds what is handed over to Reset");
 
-    if (_size == 0)
+    if (aSize == 0)
     {
-        _data.reset();
+        Release();
         return;
     }
 
-    _data = std::make_unique<T[]>(_size);
+    using Traits = std::allocator_traits<TAllocator>;
+    T* pData = Traits::allocate(_allocator, aSize);
+
+    try
+    {
+        aConstruct(pData);
+    }
+    catch (...)
+    {
+        Traits::deallocate(_allocator, pData, aSize);
+        throw;
+    }
+
+    // Like before, the old elements go only once the new ones are there
+    Release();
+
+    _data = pData;
+    _size = aSize;
 }
-template<class T>
-constexpr void moo::ScopedArray<T>::Reset(T* apData, size_t aSize) noexcept
+
+template<class T, class TAllocator, class TDeleter>
+constexpr void moo::ScopedArray<T, TAllocator, TDeleter>::Adopt(T* apData, size_t aSize) noexcept
 {
     MOO_ASSERT_RETURN(!apData == !aSize);
 
-    _data.reset(apData);
+    Release();
+
+    _data = apData;
     _size = aSize;
 }
 
-template<class T>
-[[nodiscard]] constexpr std::span<const char> moo::ScopedArray<T>::CBytes() const noexcept
+template<class T, class TAllocator, class TDeleter>
+void moo::ScopedArray<T, TAllocator, TDeleter>::Release() noexcept
 {
-    return ToCBytes(*this);
-}
-template<class T>
-[[nodiscard]] constexpr std::span<const unsigned char> moo::ScopedArray<T>::CUBytes() const noexcept
-{
-    return ToCUBytes(*this);
-}
+    if (_data == nullptr)
+    {
+        return;
+    }
 
-//-------------------------------------------------------------------------------------------------------
-// private:
+    if constexpr (cAllocates)
+    {
+        std::destroy_n(_data, _size);
+        std::allocator_traits<TAllocator>::deallocate(_allocator, _data, _size);
+    }
+    else if constexpr (std::invocable<TDeleter&, T*, size_t>)
+    {
+        _deleter(_data, _size);
+    }
+    else
+    {
+        _deleter(_data);
+    }
+
+    _data = nullptr;
+    _size = 0;
+}
 
-template<class T>
+template<class T, class TAllocator, class TDeleter>
 template<class Tv, class TSelf>
-[[nodiscard]] static inline constexpr std::_Span_iterator<Tv> moo::ScopedArray<T>::begin(TSelf* apSelf) noexcept
+[[nodiscard]] constexpr moo::SpanIterator<Tv> moo::ScopedArray<T, TAllocator, TDeleter>::begin(TSelf* apSelf) noexcept
 {
     Tv* ptr = apSelf->data();
 #if MOO_ITERATOR_DEBUG_LEVEL >= 1
@@ -172,9 +450,9 @@ template<class Tv, class TSelf>
     return { ptr };
 #endif
 }
-template<class T>
+template<class T, class TAllocator, class TDeleter>
 template<class Tv, class TSelf>
-[[nodiscard]] static inline constexpr std::_Span_iterator<Tv> moo::ScopedArray<T>::end(TSelf* apSelf) noexcept
+[[nodiscard]] constexpr moo::SpanIterator<Tv> moo::ScopedArray<T, TAllocator, TDeleter>::end(TSelf* apSelf) noexcept
 {
     Tv* ptr = apSelf->data();
     MOO_SUPPRESS(26481); // Don't use pointer arithmetic. Use span instead
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace moo {
+    // Returns the first aChar in [apBegin, apEnd), or apEnd if there is none.
+    // Compares 16 characters at a time when SSE2 is available.
+    inline const char* FindChar(const char* apBegin, const char* apEnd, char aChar) noexcept
+    {
+        const char* p = apBegin;
+
+#if defined(_M_X64) || defined(__SSE2__)
+        const __m128i needle = _mm_set1_epi8(aChar);
+
+        for (; apEnd - p >= 16; p += 16)
+        {
+            const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            const int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle));
+
+            if (mask != 0)
+            {
+                return p + std::countr_zero(static_cast<unsigned>(mask));
+            }
+        }
+#endif
+
+        for (; p != apEnd; ++p)
+        {
+            if (*p == aChar)
+            {
+                return p;
+            }
+        }
+
+        return apEnd;
+    }
+}
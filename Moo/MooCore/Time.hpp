@@ -3,7 +3,13 @@
 #include "Math/MathUtils.hpp"
 #include "MooAssert.h"
 
+#include <algorithm>
 #include <chrono>
+#include <ctime>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <string_view>
 
 namespace moo {
     constexpr size_t TimeStampSize(std::streamsize aFractionSecondsWidth = 6, bool aDate = false) noexcept
@@ -27,10 +33,23 @@ namespace moo {
 
         //---------------------------------------------1234567
         //---------------------------------------------.123456
-        return size + aFractionSecondsWidth == 0 ? 0 : 1 + aFractionSecondsWidth;
+        return size + (aFractionSecondsWidth == 0 ? 0 : 1 + aFractionSecondsWidth);
     }
 
-    inline std::string TimeStampString(std::streamsize aFractionSecondsWidth = 6, bool aDate = false)
+    // std::localtime isn't thread safe, and the safe versions differ between platforms
+    inline std::tm LocalTime(std::time_t aTime) noexcept
+    {
+        std::tm timeInfo{};
+#ifdef _WIN32
+        localtime_s(&timeInfo, &aTime);
+#else
+        localtime_r(&aTime, &timeInfo);
+#endif
+        return timeInfo;
+    }
+
+    inline std::string TimeStampString(std::chrono::system_clock::time_point aTime,
+        std::streamsize aFractionSecondsWidth = 6, bool aDate = false)
     {
         MOO_ASSERT(aFractionSecondsWidth >= 0 && aFractionSecondsWidth <= 6);
 
@@ -39,11 +58,9 @@ namespace moo {
 
         stringstream ss;
 
-        const auto now = system_clock::now();
-        const auto nowInTimeT = system_clock::to_time_t(now);
+        const auto nowInTimeT = system_clock::to_time_t(aTime);
 
-        tm timeInfo;
-        localtime_s(&timeInfo, &nowInTimeT);
+        const tm timeInfo = LocalTime(nowInTimeT);
 
         if (aDate)
         {
@@ -56,7 +73,7 @@ namespace moo {
 
         if (aFractionSecondsWidth > 0)
         {
-            const auto subsec = now - system_clock::from_time_t(nowInTimeT);
+            const auto subsec = aTime - system_clock::from_time_t(nowInTimeT);
 
             const streamsize microDivider = 1000000 / moo::Pow<streamsize>(10, aFractionSecondsWidth);
 
@@ -66,4 +83,122 @@ namespace moo {
 
         return ss.str();
     }
+
+    inline std::string TimeStampString(std::streamsize aFractionSecondsWidth = 6, bool aDate = false)
+    {
+        return TimeStampString(std::chrono::system_clock::now(), aFractionSecondsWidth, aDate);
+    }
+
+    // Formats the same time stamps as TimeStampString, without streams or allocations.
+    // The date and time part is cached per thread and only rebuilt when the second changes,
+    // so most of the time only the fraction digits are written.
+    class TimeStampFormatter {
+    public:
+        static constexpr size_t cMaxSize = TimeStampSize(6, true);
+
+        // apBuffer needs room for TimeStampSize(aFractionSecondsWidth, aDate) characters.
+        // Returns the number of characters written.
+        static size_t Format(char* apBuffer, std::chrono::system_clock::time_point aTime,
+            std::streamsize aFractionSecondsWidth = 6, bool aDate = false) noexcept;
+
+        // The view points to a thread local buffer, it's valid until the next call on the same thread
+        [[nodiscard]] static std::string_view Format(std::chrono::system_clock::time_point aTime,
+            std::streamsize aFractionSecondsWidth = 6, bool aDate = false) noexcept;
+
+    private:
+        struct SecondCache {
+            long long _second = std::numeric_limits<long long>::min();
+            bool _date = false;
+            char _text[TimeStampSize(0, true)] = {};
+            size_t _size = 0;
+        };
+
+        [[nodiscard]] static const SecondCache& CachedSecond(long long aSecond, bool aDate) noexcept;
+
+        // Writes aCount digits of aValue, zero padded, and returns the position after them
+        static char* WriteDigits(char* apOut, long long aValue, size_t aCount) noexcept;
+    };
+}
+
+inline size_t moo::TimeStampFormatter::Format(char* apBuffer, std::chrono::system_clock::time_point aTime,
+    std::streamsize aFractionSecondsWidth, bool aDate) noexcept
+{
+    MOO_ASSERT(aFractionSecondsWidth >= 0 && aFractionSecondsWidth <= 6);
+
+    using namespace std;
+    using namespace chrono;
+
+    const auto sinceEpoch = aTime.time_since_epoch();
+    const auto second = floor<seconds>(sinceEpoch);
+
+    const SecondCache& cache = CachedSecond(second.count(), aDate);
+    char* pOut = copy_n(cache._text, cache._size, apBuffer);
+
+    if (aFractionSecondsWidth > 0)
+    {
+        constexpr long long cMicroDividers[] = { 1000000, 100000, 10000, 1000, 100, 10, 1 };
+        const long long fraction =
+            duration_cast<microseconds>(sinceEpoch - second).count() / cMicroDividers[aFractionSecondsWidth];
+
+        *pOut++ = '.';
+        pOut = WriteDigits(pOut, fraction, static_cast<size_t>(aFractionSecondsWidth));
+    }
+
+    return static_cast<size_t>(pOut - apBuffer);
+}
+
+inline std::string_view moo::TimeStampFormatter::Format(std::chrono::system_clock::time_point aTime,
+    std::streamsize aFractionSecondsWidth, bool aDate) noexcept
+{
+    thread_local char tl_buffer[cMaxSize];
+    return { tl_buffer, Format(tl_buffer, aTime, aFractionSecondsWidth, aDate) };
+}
+
+inline const moo::TimeStampFormatter::SecondCache& moo::TimeStampFormatter::CachedSecond(long long aSecond,
+    bool aDate) noexcept
+{
+    thread_local SecondCache tl_cache;
+
+    if (tl_cache._second == aSecond && tl_cache._date == aDate)
+    {
+        return tl_cache;
+    }
+
+    const std::time_t timeT = static_cast<std::time_t>(aSecond);
+
+    const std::tm timeInfo = LocalTime(timeT);
+
+    char* pOut = tl_cache._text;
+
+    if (aDate)
+    {
+        pOut = WriteDigits(pOut, timeInfo.tm_year + 1900, 4);
+        *pOut++ = '-';
+        pOut = WriteDigits(pOut, timeInfo.tm_mon + 1, 2);
+        *pOut++ = '-';
+        pOut = WriteDigits(pOut, timeInfo.tm_mday, 2);
+        *pOut++ = ' ';
+    }
+
+    pOut = WriteDigits(pOut, timeInfo.tm_hour, 2);
+    *pOut++ = ':';
+    pOut = WriteDigits(pOut, timeInfo.tm_min, 2);
+    *pOut++ = ':';
+    pOut = WriteDigits(pOut, timeInfo.tm_sec, 2);
+
+    tl_cache._second = aSecond;
+    tl_cache._date = aDate;
+    tl_cache._size = static_cast<size_t>(pOut - tl_cache._text);
+    return tl_cache;
+}
+
+inline char* moo::TimeStampFormatter::WriteDigits(char* apOut, long long aValue, size_t aCount) noexcept
+{
+    for (size_t i = aCount; i > 0; --i)
+    {
+        apOut[i - 1] = static_cast<char>('0' + aValue % 10);
+        aValue /= 10;
+    }
+
+    return apOut + aCount;
 }
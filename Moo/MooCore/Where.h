@@ -20,10 +20,11 @@ namespace moo {
     inline std::string ToString(Where aWhere) noexcept;
 
     struct Where {
-        Where(const char* aFilename = nullptr, const char* aFunction = nullptr, const uint_fast32_t aLine = 0) noexcept
+        constexpr Where(const char* aFilename = nullptr, const char* aFunction = nullptr,
+            const uint_fast32_t aLine = 0) noexcept
             : filename(aFilename), function(aFunction), line(aLine) {}
 
-        operator bool() const noexcept
+        constexpr operator bool() const noexcept
         {
             return filename || function || line;
         }
@@ -32,19 +33,30 @@ namespace moo {
         const char* function;
         const uint_fast32_t line;
 
+        // Same text as ToString, written piece by piece so it doesn't allocate
         template<class Tos>
-        Tos& Print(Tos& aOs) noexcept(noexcept(std::declval<Tos>() << std::declval<std::string>()))
+        Tos& Print(Tos& aOs) const noexcept(noexcept(std::declval<Tos>() << std::declval<const char*>()))
         {
-            if (*this)
+            if (filename != nullptr)
+            {
+                aOs << filename << ", ";
+            }
+
+            if (function != nullptr)
+            {
+                aOs << function << ": ";
+            }
+
+            if (line != 0)
             {
-                aOs << ToString(*this);
+                aOs << line;
             }
 
             return aOs;
         }
 
         template<class Tos>
-        Tos& Print(Tos& aOs, std::ostream& (*aEndl)(std::ostream&))
+        Tos& Print(Tos& aOs, std::ostream& (*aEndl)(std::ostream&)) const
             noexcept(noexcept(std::declval<Tos>() << std::declval<std::ostream&(*)(std::ostream&)>()))
         {
             Print(aOs);
@@ -83,7 +95,7 @@ namespace moo {
         }
         catch (...)
         {
-            return __FUNCSIG__ " failed";
+            return "moo::ToString(moo::Where) failed";
         }
     }
 